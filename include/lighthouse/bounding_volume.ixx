@@ -7,6 +7,8 @@ module;
 export module bounding_volume;
 
 import geometry;
+import frustum;
+import collision;
 
 #if not INTELLISENSE
 import glm;
@@ -18,38 +20,440 @@ export namespace lh
 {
 	namespace geometry
 	{
-		struct octant : public aabb
+		// the first box encloses the second one
+		auto contains(const aabb&, const aabb&) -> bool;
+		auto intersects(const aabb&, const aabb&) -> bool;
+		auto intersects(const sphere&, const aabb&) -> bool;
+		// the ray needs to enter the box before reaching the distance
+		auto intersects(const ray&, const aabb&, const scalar_t max_distance) -> bool;
+
+		// bounds enclosing nothing, merging anything into them yields the bounds of that alone
+		auto empty_bounds() -> aabb
+		{
+			return {position_t {infinity}, position_t {-infinity}};
+		}
+
+		auto merge(const aabb& first, const aabb& second) -> aabb
+		{
+			return {glm::min(first.m_minima, second.m_minima), glm::max(first.m_maxima, second.m_maxima)};
+		}
+
+		auto merge(const aabb& bounds, const position_t& position) -> aabb
+		{
+			return {glm::min(bounds.m_minima, position), glm::max(bounds.m_maxima, position)};
+		}
+
+		auto surface_area(const aabb& bounds) -> scalar_t
 		{
-			octant();
-			octant(const aabb& bounding_volume, double size_threshold);
+			const auto size = bounds.m_maxima - bounds.m_minima;
 
-			octant(const octant&) = delete;
-			auto operator=(const octant&) -> octant& = delete;
-			octant(octant&& other);
-			auto operator=(octant&& other) -> octant&;
+			return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+		}
 
-			std::unique_ptr<octant[]> m_children;
+		// handle of an object in a loose octree, stale once the object is removed
+		struct octree_handle
+		{
+			using index_t = std::uint32_t;
+			using generation_t = std::uint32_t;
+
+			auto operator==(const octree_handle&) const -> bool = default;
+
+			index_t m_index = std::numeric_limits<index_t>::max();
+			generation_t m_generation = 0;
 		};
 
-		class octree : public octant
+		// sparse loose octree of object bounds, each object carrying a value of type T
+		// nodes only exist while they or their descendants hold objects, so the indexed space is unbounded
+		// level zero nodes have the root size, each further level halves it, up to the maximum depth
+		// objects are kept by the deepest node at least twice as large as they are, the one containing their center
+		// nodes reach half their size beyond their cell, so that they enclose every object they keep
+		// inserting, removing and moving objects touches a single node and at most the depth of its ancestors,
+		// objects moving while still enclosed by their node only update their bounds
+		// objects larger than the root size, or too far out for the node coordinates, are visited by every query
+		template <std::semiregular T>
+		class loose_octree
 		{
 		public:
-			enum class octant_position
-			{
-				near_bottom_left,
-				near_bottom_right,
-				near_top_left,
-				near_top_right,
-				far_bottom_left,
-				far_bottom_right,
-				far_top_left,
-				far_top_right
+			using handle = octree_handle;
+
+			struct create_info
+			{
+				scalar_t m_root_size = 256.0f;
+				std::size_t m_max_depth = 8;
+			};
+
+			loose_octree(const create_info& create_info = {})
+				: m_create_info {create_info}, m_objects {}, m_free_objects {}, m_nodes {}, m_roots {}, m_outliers {}
+			{
+				if (m_create_info.m_root_size <= 0.0f) m_create_info.m_root_size = loose_octree::create_info {}.m_root_size;
+
+				m_create_info.m_max_depth = std::min(m_create_info.m_max_depth, s_max_level);
+			}
+
+			auto insert(const aabb& bounds, const T& value) -> handle
+			{
+				auto index = static_cast<handle::index_t>(m_objects.size());
+
+				if (m_free_objects.empty())
+					m_objects.emplace_back();
+				else
+				{
+					index = m_free_objects.back();
+					m_free_objects.pop_back();
+				}
+
+				auto& object = m_objects[index];
+
+				object.m_bounds = bounds;
+				object.m_value = value;
+				object.m_alive = true;
+
+				attach(index, node_of(bounds));
+
+				return {index, object.m_generation};
+			}
+
+			auto remove(const handle& handle) -> void
+			{
+				if (not valid(handle)) return;
+
+				auto& object = m_objects[handle.m_index];
+
+				detach(handle.m_index);
+
+				object.m_value = {};
+				object.m_alive = false;
+				object.m_generation++;
+				m_free_objects.push_back(handle.m_index);
+			}
+
+			auto move(const handle& handle, const aabb& bounds) -> void
+			{
+				if (not valid(handle)) return;
+
+				auto& object = m_objects[handle.m_index];
+				const auto node = node_of(bounds);
+
+				object.m_bounds = bounds;
+
+				// objects stay with their node while it still encloses them, even once their center left its cell
+				if (node == object.m_node or (node != s_outlier and object.m_node != s_outlier and
+											  level_of(node) == level_of(object.m_node) and
+											  contains(node_bounds(object.m_node), bounds)))
+					return;
+
+				detach(handle.m_index);
+				attach(handle.m_index, node);
+			}
+
+			auto valid(const handle& handle) const -> bool
+			{
+				return handle.m_index < m_objects.size() and m_objects[handle.m_index].m_alive and
+					   m_objects[handle.m_index].m_generation == handle.m_generation;
+			}
+
+			auto bounds(const handle& handle) const -> const aabb& { return m_objects[handle.m_index].m_bounds; }
+			auto value(const handle& handle) const -> const T& { return m_objects[handle.m_index].m_value; }
+			auto size() const -> const std::size_t { return m_objects.size() - m_free_objects.size(); }
+			auto node_count() const -> const std::size_t { return m_nodes.size(); }
+
+			// queries call the function with the value of every object whose bounds intersect the volume
+			// function(const T&), objects are visited once and in no particular order
+			template <typename F>
+			auto query(const aabb& volume, const F& function) const -> void
+			{
+				const auto test = [&volume](const aabb& bounds) { return intersects(volume, bounds); };
+
+				visit(test, test, function, volume);
+			}
+
+			template <typename F>
+			auto query(const sphere& volume, const F& function) const -> void
+			{
+				const auto test = [&volume](const aabb& bounds) { return intersects(volume, bounds); };
+
+				visit(test,
+					  test,
+					  function,
+					  aabb {volume.m_position - vec3_t {volume.m_radius}, volume.m_position + vec3_t {volume.m_radius}});
+			}
+
+			template <typename F>
+			auto query(const frustum& volume, const F& function) const -> void
+			{
+				const auto test = [&volume](const aabb& bounds) { return volume.intersects(bounds); };
+
+				visit(test, test, function);
+			}
+
+			// objects whose bounds the ray enters before reaching the distance
+			template <typename F>
+			auto query(const ray& ray,
+					   const F& function,
+					   const scalar_t max_distance = std::numeric_limits<scalar_t>::infinity()) const -> void
+			{
+				const auto test = [&ray, max_distance](const aabb& bounds) { return intersects(ray, bounds, max_distance); };
+
+				visit(test, test, function);
+			}
+
+		private:
+			// nodes are keyed by their level in the top bits, followed by their biased cell coordinates
+			using key_t = std::uint64_t;
+
+			// the largest level is left unused, so that the outlier key does not name a node
+			static inline constexpr auto s_max_level = std::size_t {14};
+			static inline constexpr auto s_coordinate_bits = 20;
+			static inline constexpr auto s_coordinate_bias = std::int32_t {1} << (s_coordinate_bits - 1);
+			static inline constexpr auto s_coordinate_mask = (key_t {1} << s_coordinate_bits) - 1;
+			static inline constexpr auto s_outlier = std::numeric_limits<key_t>::max();
+			// depth first traversals hold the unvisited siblings of every level, along with the children of the last
+			static inline constexpr auto s_traversal_stack_size = 8 * (s_max_level + 1);
+
+			struct object
+			{
+				aabb m_bounds = {};
+				T m_value = {};
+				key_t m_node = s_outlier;
+				// position within the objects of the node, or within the outliers
+				std::uint32_t m_position = 0;
+				handle::generation_t m_generation = 0;
+				bool m_alive = false;
 			};
 
-			octree(const glm::vec3& center, const glm::vec3& extents, const double size_threshold);
-			octree(const aabb& bounding_volume, const double size_threshold);
+			struct node
+			{
+				std::vector<std::uint32_t> m_objects = {};
+				// bit per octant, set for children that exist
+				std::uint8_t m_children = 0;
+			};
+
+			static auto make_key(const std::size_t level, const glm::ivec3& cell) -> key_t
+			{
+				return static_cast<key_t>(level) << (3 * s_coordinate_bits) |
+					   (static_cast<key_t>(cell.x + s_coordinate_bias) & s_coordinate_mask) |
+					   (static_cast<key_t>(cell.y + s_coordinate_bias) & s_coordinate_mask) << s_coordinate_bits |
+					   (static_cast<key_t>(cell.z + s_coordinate_bias) & s_coordinate_mask) << (2 * s_coordinate_bits);
+			}
+
+			static auto level_of(const key_t key) -> std::size_t
+			{
+				return static_cast<std::size_t>(key >> (3 * s_coordinate_bits));
+			}
+
+			static auto cell_of(const key_t key) -> glm::ivec3
+			{
+				return {static_cast<std::int32_t>(key & s_coordinate_mask) - s_coordinate_bias,
+						static_cast<std::int32_t>(key >> s_coordinate_bits & s_coordinate_mask) - s_coordinate_bias,
+						static_cast<std::int32_t>(key >> (2 * s_coordinate_bits) & s_coordinate_mask) - s_coordinate_bias};
+			}
+
+			static auto parent_of(const key_t key) -> key_t
+			{
+				return make_key(level_of(key) - 1, cell_of(key) >> 1);
+			}
+
+			// octant of the parent the node lies in
+			static auto octant_of(const key_t key) -> std::uint8_t
+			{
+				const auto cell = cell_of(key) & 1;
+
+				return static_cast<std::uint8_t>(cell.x | cell.y << 1 | cell.z << 2);
+			}
+
+			static auto child_of(const key_t key, const std::uint8_t octant) -> key_t
+			{
+				const auto offset = glm::ivec3 {octant & 1, octant >> 1 & 1, octant >> 2 & 1};
+
+				return make_key(level_of(key) + 1, cell_of(key) * 2 + offset);
+			}
+
+			auto node_size(const std::size_t level) const -> scalar_t
+			{
+				return std::ldexp(m_create_info.m_root_size, -static_cast<int>(level));
+			}
+
+			// loose bounds of the node, its cell extended by half its size on every side
+			auto node_bounds(const key_t key) const -> aabb
+			{
+				const auto size = node_size(level_of(key));
+				const auto minima = vec3_t {cell_of(key)} * size;
+
+				return {minima - size * 0.5f, minima + size * 1.5f};
+			}
+
+			auto node_of(const aabb& bounds) const -> key_t
+			{
+				const auto extent = std::max({bounds.m_maxima.x - bounds.m_minima.x,
+											  bounds.m_maxima.y - bounds.m_minima.y,
+											  bounds.m_maxima.z - bounds.m_minima.z});
+
+				if (not(extent <= m_create_info.m_root_size)) return s_outlier;
+
+				// the deepest level whose nodes are at least twice as large as the object,
+				// leaving it room to move before it needs to change nodes
+				const auto max_depth = static_cast<scalar_t>(m_create_info.m_max_depth);
+				const auto level = static_cast<std::size_t>(
+					extent > 0.0f
+						? std::clamp(std::floor(std::log2(m_create_info.m_root_size / (2.0f * extent))), 0.0f, max_depth)
+						: max_depth);
+
+				const auto cell = glm::floor((bounds.m_minima + bounds.m_maxima) * 0.5f / node_size(level));
+				const auto limit = static_cast<scalar_t>(s_coordinate_bias);
+
+				if (glm::any(glm::lessThan(cell, vec3_t {-limit})) or glm::any(glm::greaterThanEqual(cell, vec3_t {limit})))
+					return s_outlier;
+
+				return make_key(level, glm::ivec3 {cell});
+			}
+
+			auto attach(const std::uint32_t index, const key_t key) -> void
+			{
+				auto& object = m_objects[index];
+
+				object.m_node = key;
+
+				if (key == s_outlier)
+				{
+					object.m_position = static_cast<std::uint32_t>(m_outliers.size());
+					m_outliers.push_back(index);
+					return;
+				}
+
+				const auto [found, created] = m_nodes.try_emplace(key);
+
+				object.m_position = static_cast<std::uint32_t>(found->second.m_objects.size());
+				found->second.m_objects.push_back(index);
+
+				// new nodes are linked into their ancestors, up to the first one that already existed
+				for (auto child = key, linking = created; linking;)
+				{
+					if (level_of(child) == 0)
+					{
+						m_roots.push_back(child);
+						break;
+					}
+
+					const auto [parent, parent_created] = m_nodes.try_emplace(parent_of(child));
+
+					parent->second.m_children |= static_cast<std::uint8_t>(1 << octant_of(child));
+					child = parent->first;
+					linking = parent_created;
+				}
+			}
+
+			auto detach(const std::uint32_t index) -> void
+			{
+				const auto& object = m_objects[index];
+				auto& objects = object.m_node == s_outlier ? m_outliers : m_nodes.find(object.m_node)->second.m_objects;
+
+				// the last object of the node takes over the position
+				const auto moved = objects.back();
+
+				objects[object.m_position] = moved;
+				m_objects[moved].m_position = object.m_position;
+				objects.pop_back();
+
+				if (object.m_node == s_outlier or not objects.empty()) return;
+
+				// empty nodes without children are erased, along with ancestors left empty by it
+				for (auto key = object.m_node;;)
+				{
+					const auto found = m_nodes.find(key);
+
+					if (not found->second.m_objects.empty() or found->second.m_children) break;
+
+					m_nodes.erase(found);
+
+					if (level_of(key) == 0)
+					{
+						std::erase(m_roots, key);
+						break;
+					}
+
+					const auto parent = parent_of(key);
+
+					m_nodes.find(parent)->second.m_children &= static_cast<std::uint8_t>(~(1 << octant_of(key)));
+					key = parent;
+				}
+			}
+
+			// only the roots whose loose bounds reach into the extent are visited, if the query has one
+			template <typename N, typename O, typename F>
+			auto visit(const N& node_test,
+					   const O& object_test,
+					   const F& function,
+					   const std::optional<aabb>& extent = std::nullopt) const -> void
+			{
+				const auto visit_objects = [this, &object_test, &function](const std::vector<std::uint32_t>& objects) {
+					for (const auto index : objects)
+						if (object_test(m_objects[index].m_bounds)) std::invoke(function, m_objects[index].m_value);
+				};
+
+				visit_objects(m_outliers);
+
+				auto stack = std::array<key_t, s_traversal_stack_size> {};
+				auto stack_size = std::size_t {};
+
+				const auto visit_root = [&](const key_t root) {
+					if (not node_test(node_bounds(root))) return;
+
+					stack[stack_size++] = root;
+
+					while (stack_size)
+					{
+						const auto key = stack[--stack_size];
+						const auto& node = m_nodes.find(key)->second;
+
+						visit_objects(node.m_objects);
+
+						for (auto octant = std::uint8_t {}; octant < 8; octant++)
+						{
+							if (not(node.m_children & 1 << octant)) continue;
+
+							const auto child = child_of(key, octant);
+
+							if (node_test(node_bounds(child))) stack[stack_size++] = child;
+						}
+					}
+				};
+
+				if (extent)
+				{
+					// root cells whose loose bounds overlap the extent
+					const auto size = m_create_info.m_root_size;
+					const auto limit = vec3_t {static_cast<scalar_t>(s_coordinate_bias - 1)};
+					const auto minimum = glm::clamp(glm::ceil((extent->m_minima - vec3_t {size * 1.5f}) / size), -limit, limit);
+					const auto maximum = glm::clamp(glm::floor((extent->m_maxima + vec3_t {size * 0.5f}) / size), -limit, limit);
+					const auto cells = glm::max(maximum - minimum + vec3_t {1.0f}, vec3_t {0.0f});
+
+					// extents spanning more root cells than there are roots visit the roots instead
+					if (cells.x * cells.y * cells.z <= static_cast<scalar_t>(m_roots.size()))
+					{
+						const auto first = glm::ivec3 {minimum};
+						const auto last = glm::ivec3 {maximum};
+
+						for (auto z = first.z; z <= last.z; z++)
+							for (auto y = first.y; y <= last.y; y++)
+								for (auto x = first.x; x <= last.x; x++)
+									if (const auto root = make_key(0, {x, y, z}); m_nodes.contains(root)) visit_root(root);
+
+						return;
+					}
+				}
+
+				for (const auto root : m_roots)
+					visit_root(root);
+			}
+
+			create_info m_create_info;
+
+			std::vector<object> m_objects;
+			std::vector<std::uint32_t> m_free_objects;
 
-			std::size_t m_depth;
+			std::unordered_map<key_t, node> m_nodes;
+			std::vector<key_t> m_roots;
+			std::vector<std::uint32_t> m_outliers;
 		};
 	}
 }
@@ -0,0 +1,102 @@
+module;
+
+#if INTELLISENSE
+#include "glm/vec3.hpp"
+#endif
+
+export module bvh;
+
+import geometry;
+import collision;
+import scene_data;
+
+#if not INTELLISENSE
+import glm;
+#endif
+
+import std;
+
+export namespace lh
+{
+	namespace geometry
+	{
+		// bounding volume hierarchy over the triangles of a mesh, for ray queries on the cpu
+		// built top down with a binned surface area heuristic, then flattened into depth first order
+		// hits report the index the triangle had in the source data, not its position within the hierarchy
+		class bvh
+		{
+		public:
+			static inline constexpr auto s_packet_width = std::size_t {8};
+
+			using packet_t = collision::ray_packet<s_packet_width>;
+			using packet_hits_t = std::array<collision::ray_hit, s_packet_width>;
+
+			struct create_info
+			{
+				// nodes with fewer triangles become leaves once splitting them is estimated to cost more than testing them
+				std::uint16_t m_max_leaf_triangles = 4;
+				// number of buckets the centroids are sorted into along each axis, when evaluating splits
+				std::size_t m_bin_count = 16;
+				// cost of visiting a node, relative to testing a triangle
+				scalar_t m_traversal_cost = 1.0f;
+			};
+
+			// interior nodes are followed by their first child, the second child is at the offset
+			// leaf nodes hold the range of triangles starting at the offset
+			struct node
+			{
+				auto leaf() const -> bool { return m_triangle_count != 0; }
+
+				aabb m_bounds;
+				std::uint32_t m_offset;
+				std::uint16_t m_triangle_count;
+				// axis the children were split along, the nearer child along it is visited first by packets
+				std::uint16_t m_axis;
+			};
+
+			bvh(std::span<const triangle>, const create_info& = {});
+			// every three indices into the positions form a triangle
+			bvh(std::span<const position_t>, std::span<const std::uint32_t> indices, const create_info& = {});
+			// triangles of a mesh of the scene data, in mesh space
+			bvh(const scene_data&, const std::size_t mesh_index, const create_info& = {});
+
+			// nearest hit closer than the distance
+			auto closest_hit(const ray&, const scalar_t max_distance = std::numeric_limits<scalar_t>::infinity()) const
+				-> collision::ray_hit;
+			// stops at the first hit closer than the distance, for occlusion queries
+			auto any_hit(const ray&, const scalar_t max_distance = std::numeric_limits<scalar_t>::infinity()) const
+				-> bool;
+			// nearest hits of every ray of the packet, nodes are visited once for all rays that could hit them
+			// coherent rays, such as those of neighbouring pixels, share most of their traversal
+			auto closest_hits(const packet_t&,
+							  const scalar_t max_distance = std::numeric_limits<scalar_t>::infinity()) const
+				-> packet_hits_t;
+
+			auto bounds() const -> const aabb&;
+			auto nodes() const -> std::span<const node>;
+			auto triangle_count() const -> const std::size_t;
+
+		private:
+			// splits past this depth fall back to halving the triangle count, keeping the traversal stack bounded
+			static inline constexpr auto s_max_sah_depth = std::size_t {32};
+			static inline constexpr auto s_max_depth = std::size_t {64};
+			// a pending sibling for every level above the deepest interior node, along with both of its children
+			static inline constexpr auto s_traversal_stack_size = s_max_depth + 1;
+			static inline constexpr auto s_max_bin_count = std::size_t {64};
+
+			auto build(std::span<const triangle>) -> void;
+			auto build_node(std::span<const aabb> triangle_bounds,
+							std::span<const position_t> centroids,
+							const std::uint32_t first,
+							const std::uint32_t count,
+							const std::size_t depth) -> void;
+
+			create_info m_create_info;
+
+			std::vector<node> m_nodes;
+			// triangles ordered by leaf, along with their index in the source data
+			std::vector<triangle> m_triangles;
+			std::vector<std::uint32_t> m_triangle_indices;
+		};
+	}
+}
@@ -78,7 +78,7 @@ export namespace lh
 
 		auto look_at(const geometry::position_t& target) -> void
 		{
-			auto view = glm::quatLookAt(glm::normalize(m_position + target), s_up_direction);
+			auto view = glm::quatLookAt(glm::normalize(position() + target), s_up_direction);
 			// don't ask
 			view.w *= -1.0f;
 
@@ -4,6 +4,10 @@ module;
 #include "glm/glm.hpp"
 #endif
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 export module collision;
 
 import geometry;
@@ -48,9 +52,12 @@ export namespace lh
 			return result;
 		}
 
-		bool ray_aabb_test(const lh::geometry::ray& ray, const lh::geometry::aabb& aabb)
+		// the ray needs to enter the box before reaching the distance
+		bool ray_aabb_test(const lh::geometry::ray& ray,
+						   const lh::geometry::aabb& aabb,
+						   const lh::geometry::scalar_t max_distance = lh::geometry::infinity)
 		{
-			float tmin = 0.0, tmax = std::numeric_limits<float>::infinity();
+			float tmin = 0.0, tmax = max_distance;
 			const auto ray_inv = glm::vec3 {1.0f} / ray.m_direction;
 
 			for (int d = 0; d < 3; ++d)
@@ -64,5 +71,270 @@ export namespace lh
 
 			return tmin <= tmax;
 		}
+
+		// nearest intersection found by a batched test
+		// the triangle index is the lane within a batch, or batch index * lane count + lane across batches
+		struct ray_hit
+		{
+			static inline constexpr auto s_no_triangle = std::numeric_limits<std::uint32_t>::max();
+
+			auto hit() const -> bool { return m_triangle != s_no_triangle; }
+
+			lh::geometry::scalar_t m_distance = std::numeric_limits<lh::geometry::scalar_t>::infinity();
+			// barycentric coordinates of the hit, relative to the second and third vertex
+			lh::geometry::scalar_t m_u = 0.0f;
+			lh::geometry::scalar_t m_v = 0.0f;
+			std::uint32_t m_triangle = s_no_triangle;
+		};
+
+		// N triangles in structure of arrays layout, one lane per triangle, each array holding one coordinate
+		// unused lanes hold degenerate triangles, which never report a hit
+		template <std::size_t N>
+		struct triangle_batch
+		{
+			using lanes_t = std::array<lh::geometry::scalar_t, N>;
+
+			alignas(sizeof(lanes_t)) std::array<lanes_t, 3> m_vertex;
+			alignas(sizeof(lanes_t)) std::array<lanes_t, 3> m_edge_1;
+			alignas(sizeof(lanes_t)) std::array<lanes_t, 3> m_edge_2;
+		};
+
+		// N rays in structure of arrays layout, one lane per ray
+		template <std::size_t N>
+		struct ray_packet
+		{
+			using lanes_t = std::array<lh::geometry::scalar_t, N>;
+
+			alignas(sizeof(lanes_t)) std::array<lanes_t, 3> m_position;
+			alignas(sizeof(lanes_t)) std::array<lanes_t, 3> m_direction;
+		};
+
+		// packs triangles into batches of N, padding the last batch with degenerate triangles
+		template <std::size_t N>
+		auto make_triangle_batches(std::span<const lh::geometry::triangle> triangles) -> std::vector<triangle_batch<N>>
+		{
+			auto batches = std::vector<triangle_batch<N>>((triangles.size() + N - 1) / N, triangle_batch<N> {});
+
+			for (auto i = std::size_t {}; i < triangles.size(); i++)
+			{
+				auto& batch = batches[i / N];
+				const auto lane = i % N;
+				const auto& triangle = triangles[i];
+				const auto edge_1 = triangle.m_y - triangle.m_x;
+				const auto edge_2 = triangle.m_z - triangle.m_x;
+
+				for (auto axis = 0; axis < 3; axis++)
+				{
+					batch.m_vertex[axis][lane] = triangle.m_x[axis];
+					batch.m_edge_1[axis][lane] = edge_1[axis];
+					batch.m_edge_2[axis][lane] = edge_2[axis];
+				}
+			}
+
+			return batches;
+		}
+
+		template <std::size_t N>
+		auto make_ray_packet(std::span<const lh::geometry::ray, N> rays) -> ray_packet<N>
+		{
+			auto packet = ray_packet<N> {};
+
+			for (auto lane = std::size_t {}; lane < N; lane++)
+				for (auto axis = 0; axis < 3; axis++)
+				{
+					packet.m_position[axis][lane] = rays[lane].m_position[axis];
+					packet.m_direction[axis][lane] = rays[lane].m_direction[axis];
+				}
+
+			return packet;
+		}
+
+#if defined(__AVX2__)
+		// eight lane kernel written with avx2 intrinsics, preferred by overload resolution over the generic one
+		inline auto ray_tri_batch_test(const lh::geometry::ray& ray, const triangle_batch<8>& batch) -> ray_hit
+		{
+			const auto zero = _mm256_setzero_ps();
+			const auto one = _mm256_set1_ps(1.0f);
+			const auto epsilon = _mm256_set1_ps(lh::geometry::epsilon);
+			const auto infinity = _mm256_set1_ps(std::numeric_limits<lh::geometry::scalar_t>::infinity());
+
+			const auto dx = _mm256_set1_ps(ray.m_direction.x);
+			const auto dy = _mm256_set1_ps(ray.m_direction.y);
+			const auto dz = _mm256_set1_ps(ray.m_direction.z);
+
+			const auto e1x = _mm256_load_ps(batch.m_edge_1[0].data());
+			const auto e1y = _mm256_load_ps(batch.m_edge_1[1].data());
+			const auto e1z = _mm256_load_ps(batch.m_edge_1[2].data());
+			const auto e2x = _mm256_load_ps(batch.m_edge_2[0].data());
+			const auto e2y = _mm256_load_ps(batch.m_edge_2[1].data());
+			const auto e2z = _mm256_load_ps(batch.m_edge_2[2].data());
+
+			const auto px = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+			const auto py = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+			const auto pz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+
+			const auto determinant = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, px), _mm256_mul_ps(e1y, py)),
+												   _mm256_mul_ps(e1z, pz));
+			const auto absolute_determinant = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), determinant);
+			const auto non_degenerate = _mm256_cmp_ps(absolute_determinant, epsilon, _CMP_GT_OQ);
+			const auto inverse_determinant = _mm256_div_ps(one, _mm256_blendv_ps(one, determinant, non_degenerate));
+
+			const auto sx = _mm256_sub_ps(_mm256_set1_ps(ray.m_position.x), _mm256_load_ps(batch.m_vertex[0].data()));
+			const auto sy = _mm256_sub_ps(_mm256_set1_ps(ray.m_position.y), _mm256_load_ps(batch.m_vertex[1].data()));
+			const auto sz = _mm256_sub_ps(_mm256_set1_ps(ray.m_position.z), _mm256_load_ps(batch.m_vertex[2].data()));
+
+			const auto u = _mm256_mul_ps(
+				_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, px), _mm256_mul_ps(sy, py)), _mm256_mul_ps(sz, pz)),
+				inverse_determinant);
+
+			const auto qx = _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(sz, e1y));
+			const auto qy = _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(sx, e1z));
+			const auto qz = _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(sy, e1x));
+
+			const auto v = _mm256_mul_ps(
+				_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)),
+				inverse_determinant);
+			const auto t = _mm256_mul_ps(
+				_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)),
+				inverse_determinant);
+
+			auto hits = _mm256_and_ps(non_degenerate, _mm256_cmp_ps(u, zero, _CMP_GE_OQ));
+			hits = _mm256_and_ps(hits, _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+			hits = _mm256_and_ps(hits, _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ));
+			hits = _mm256_and_ps(hits, _mm256_cmp_ps(t, epsilon, _CMP_GT_OQ));
+
+			const auto distances = _mm256_blendv_ps(infinity, t, hits);
+
+			// horizontal minimum, broadcast to every lane
+			auto nearest = _mm256_min_ps(distances, _mm256_permute2f128_ps(distances, distances, 0x01));
+			nearest = _mm256_min_ps(nearest, _mm256_shuffle_ps(nearest, nearest, _MM_SHUFFLE(1, 0, 3, 2)));
+			nearest = _mm256_min_ps(nearest, _mm256_shuffle_ps(nearest, nearest, _MM_SHUFFLE(2, 3, 0, 1)));
+
+			const auto nearest_lanes = _mm256_movemask_ps(_mm256_and_ps(hits, _mm256_cmp_ps(distances, nearest, _CMP_EQ_OQ)));
+
+			if (nearest_lanes == 0) return {};
+
+			alignas(32) auto us = std::array<lh::geometry::scalar_t, 8> {};
+			alignas(32) auto vs = std::array<lh::geometry::scalar_t, 8> {};
+			_mm256_store_ps(us.data(), u);
+			_mm256_store_ps(vs.data(), v);
+
+			const auto lane = static_cast<std::uint32_t>(std::countr_zero(static_cast<unsigned int>(nearest_lanes)));
+
+			return {_mm256_cvtss_f32(nearest), us[lane], vs[lane], lane};
+		}
+#endif
+
+		// nearest intersection of the ray with the triangles of the batch
+		// lanes are evaluated without branches, so that the loop vectorizes to the lane count
+		template <std::size_t N>
+		auto ray_tri_batch_test(const lh::geometry::ray& ray, const triangle_batch<N>& batch) -> ray_hit
+		{
+			using scalar_t = lh::geometry::scalar_t;
+
+			alignas(sizeof(typename triangle_batch<N>::lanes_t)) auto distances = typename triangle_batch<N>::lanes_t {};
+			alignas(sizeof(typename triangle_batch<N>::lanes_t)) auto us = typename triangle_batch<N>::lanes_t {};
+			alignas(sizeof(typename triangle_batch<N>::lanes_t)) auto vs = typename triangle_batch<N>::lanes_t {};
+
+			const auto [dx, dy, dz] = std::array {ray.m_direction.x, ray.m_direction.y, ray.m_direction.z};
+			const auto [ox, oy, oz] = std::array {ray.m_position.x, ray.m_position.y, ray.m_position.z};
+
+			for (auto lane = std::size_t {}; lane < N; lane++)
+			{
+				const auto e1x = batch.m_edge_1[0][lane], e1y = batch.m_edge_1[1][lane], e1z = batch.m_edge_1[2][lane];
+				const auto e2x = batch.m_edge_2[0][lane], e2y = batch.m_edge_2[1][lane], e2z = batch.m_edge_2[2][lane];
+
+				const auto px = dy * e2z - dz * e2y, py = dz * e2x - dx * e2z, pz = dx * e2y - dy * e2x;
+				const auto determinant = e1x * px + e1y * py + e1z * pz;
+				const auto non_degenerate = std::abs(determinant) > lh::geometry::epsilon;
+				const auto inverse_determinant = scalar_t {1.0f} / (non_degenerate ? determinant : scalar_t {1.0f});
+
+				const auto sx = ox - batch.m_vertex[0][lane];
+				const auto sy = oy - batch.m_vertex[1][lane];
+				const auto sz = oz - batch.m_vertex[2][lane];
+				const auto u = (sx * px + sy * py + sz * pz) * inverse_determinant;
+
+				const auto qx = sy * e1z - sz * e1y, qy = sz * e1x - sx * e1z, qz = sx * e1y - sy * e1x;
+				const auto v = (dx * qx + dy * qy + dz * qz) * inverse_determinant;
+				const auto t = (e2x * qx + e2y * qy + e2z * qz) * inverse_determinant;
+
+				const auto hit = non_degenerate & (u >= 0.0f) & (v >= 0.0f) & (u + v <= 1.0f) & (t > lh::geometry::epsilon);
+
+				distances[lane] = hit ? t : std::numeric_limits<scalar_t>::infinity();
+				us[lane] = u;
+				vs[lane] = v;
+			}
+
+			auto result = ray_hit {};
+
+			for (auto lane = std::uint32_t {}; lane < N; lane++)
+				if (distances[lane] < result.m_distance) result = {distances[lane], us[lane], vs[lane], lane};
+
+			return result;
+		}
+
+		// nearest intersection of the ray with the triangles of every batch
+		template <std::size_t N>
+		auto ray_tri_batch_test(const lh::geometry::ray& ray, std::span<const triangle_batch<N>> batches) -> ray_hit
+		{
+			auto result = ray_hit {};
+
+			for (auto i = std::size_t {}; i < batches.size(); i++)
+			{
+				const auto hit = ray_tri_batch_test(ray, batches[i]);
+
+				if (hit.m_distance < result.m_distance)
+					result = {hit.m_distance, hit.m_u, hit.m_v, static_cast<std::uint32_t>(i * N + hit.m_triangle)};
+			}
+
+			return result;
+		}
+
+		// intersects every ray of the packet with the triangle, keeping the nearest hit of each ray
+		// the triangle index is recorded for rays whose nearest hit the triangle becomes
+		template <std::size_t N>
+		auto ray_packet_tri_test(const ray_packet<N>& packet,
+								 const lh::geometry::triangle& triangle,
+								 const std::uint32_t triangle_index,
+								 std::array<ray_hit, N>& hits) -> void
+		{
+			using scalar_t = lh::geometry::scalar_t;
+
+			const auto edge_1 = triangle.m_y - triangle.m_x;
+			const auto edge_2 = triangle.m_z - triangle.m_x;
+
+			for (auto lane = std::size_t {}; lane < N; lane++)
+			{
+				const auto dx = packet.m_direction[0][lane], dy = packet.m_direction[1][lane],
+						   dz = packet.m_direction[2][lane];
+
+				const auto px = dy * edge_2.z - dz * edge_2.y;
+				const auto py = dz * edge_2.x - dx * edge_2.z;
+				const auto pz = dx * edge_2.y - dy * edge_2.x;
+				const auto determinant = edge_1.x * px + edge_1.y * py + edge_1.z * pz;
+				const auto non_degenerate = std::abs(determinant) > lh::geometry::epsilon;
+				const auto inverse_determinant = scalar_t {1.0f} / (non_degenerate ? determinant : scalar_t {1.0f});
+
+				const auto sx = packet.m_position[0][lane] - triangle.m_x.x;
+				const auto sy = packet.m_position[1][lane] - triangle.m_x.y;
+				const auto sz = packet.m_position[2][lane] - triangle.m_x.z;
+				const auto u = (sx * px + sy * py + sz * pz) * inverse_determinant;
+
+				const auto qx = sy * edge_1.z - sz * edge_1.y;
+				const auto qy = sz * edge_1.x - sx * edge_1.z;
+				const auto qz = sx * edge_1.y - sy * edge_1.x;
+				const auto v = (dx * qx + dy * qy + dz * qz) * inverse_determinant;
+				const auto t = (edge_2.x * qx + edge_2.y * qy + edge_2.z * qz) * inverse_determinant;
+
+				auto& hit = hits[lane];
+				const auto nearer = non_degenerate & (u >= 0.0f) & (v >= 0.0f) & (u + v <= 1.0f) &
+									(t > lh::geometry::epsilon) & (t < hit.m_distance);
+
+				hit.m_distance = nearer ? t : hit.m_distance;
+				hit.m_u = nearer ? u : hit.m_u;
+				hit.m_v = nearer ? v : hit.m_v;
+				hit.m_triangle = nearer ? triangle_index : hit.m_triangle;
+			}
+		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,269 @@
+module;
+
+export module ecs;
+
+import lighthouse_utility;
+
+import std;
+
+export namespace lh
+{
+	namespace ecs
+	{
+		using component_id_t = std::uint32_t;
+
+		// handle of an entity in an ecs world, stale once the entity is destroyed
+		struct entity
+		{
+			using index_t = std::uint32_t;
+			using generation_t = std::uint32_t;
+
+			auto operator==(const entity&) const -> bool = default;
+
+			index_t m_index = std::numeric_limits<index_t>::max();
+			generation_t m_generation = 0;
+		};
+
+		auto next_component_id() -> component_id_t;
+
+		// unique id of each component type, assigned on first use
+		template <typename T>
+		auto component_id() -> component_id_t
+		{
+			static const auto id = next_component_id();
+
+			return id;
+		}
+
+		// type erased storage of a single component type, one component per archetype row
+		class column
+		{
+		public:
+			virtual ~column() = default;
+
+			// empty column of the same component type
+			virtual auto create_empty() const -> std::unique_ptr<column> = 0;
+			// appends the component at the row to the other column, leaving a moved from component behind
+			virtual auto move_to(column&, const std::size_t row) -> void = 0;
+			// removes the component at the row, moving the last component into its place
+			virtual auto erase(const std::size_t row) -> void = 0;
+			virtual auto size() const -> const std::size_t = 0;
+		};
+
+		template <typename T>
+		class typed_column final : public column
+		{
+		public:
+			auto create_empty() const -> std::unique_ptr<column> override { return std::make_unique<typed_column>(); }
+
+			auto move_to(column& other, const std::size_t row) -> void override
+			{
+				static_cast<typed_column&>(other).m_components.push_back(std::move(m_components[row]));
+			}
+
+			auto erase(const std::size_t row) -> void override
+			{
+				if (row + 1 != m_components.size()) m_components[row] = std::move(m_components.back());
+
+				m_components.pop_back();
+			}
+
+			auto size() const -> const std::size_t override { return m_components.size(); }
+
+			std::vector<T> m_components;
+		};
+
+		// table of all entities sharing the same set of component types
+		// every component type is stored in its own contiguous column, rows of all columns belong to the same entity
+		struct archetype
+		{
+			static inline constexpr auto s_npos = std::numeric_limits<std::size_t>::max();
+
+			auto column_index(const component_id_t) const -> std::size_t;
+
+			// sorted component ids, parallel to the columns
+			std::vector<component_id_t> m_signature;
+			std::vector<std::unique_ptr<column>> m_columns;
+			std::vector<entity> m_entities;
+
+			// archetypes reached by adding or removing a single component type
+			std::unordered_map<component_id_t, non_owning_ptr<archetype>> m_add_edges;
+			std::unordered_map<component_id_t, non_owning_ptr<archetype>> m_remove_edges;
+		};
+
+		// entity component storage, organized into archetype tables
+		// queries visit every archetype containing the requested component types, over contiguous columns
+		// adding or removing components moves an entity into another archetype, invalidating component references
+		// structural changes are not allowed while a query is running
+		// existing objects, such as lights, cameras and meshes, can be registered as non owning pointer components
+		class world
+		{
+		public:
+			world();
+			world(const world&) = delete;
+			auto operator=(const world&) -> world& = delete;
+
+			auto create() -> entity;
+			auto destroy(const entity&) -> void;
+			auto valid(const entity&) const -> bool;
+			auto size() const -> const std::size_t;
+			auto archetypes() const -> const std::vector<std::unique_ptr<archetype>>&;
+
+			// replaces the component if the entity already has one of the type, returns nullptr if the entity is stale
+			template <typename T>
+			auto add(const entity& entity, T&& component) -> std::remove_cvref_t<T>*
+			{
+				using component_t = std::remove_cvref_t<T>;
+
+				if (not valid(entity)) return nullptr;
+
+				const auto id = component_id<component_t>();
+
+				if (auto existing = get<component_t>(entity))
+				{
+					*existing = std::forward<T>(component);
+					return existing;
+				}
+
+				auto& record = m_records[entity.m_index];
+				auto& destination_edge = record.m_archetype->m_add_edges[id];
+
+				if (not destination_edge)
+				{
+					auto signature = record.m_archetype->m_signature;
+					signature.insert(std::ranges::upper_bound(signature, id), id);
+
+					destination_edge = find_or_create_archetype(signature, *record.m_archetype, [](const component_id_t) {
+						return std::make_unique<typed_column<component_t>>();
+					});
+				}
+
+				const auto destination = destination_edge;
+
+				move_entity(entity, *destination);
+
+				auto& column = static_cast<typed_column<component_t>&>(
+					*destination->m_columns[destination->column_index(id)]);
+
+				return &column.m_components.emplace_back(std::forward<T>(component));
+			}
+
+			// registers an existing object as a component of the entity, the object needs to outlive it
+			template <typename T>
+			auto add_reference(const entity& entity, T& object) -> non_owning_ptr<T>*
+			{
+				return add(entity, non_owning_ptr<T> {&object});
+			}
+
+			template <typename T>
+			auto remove(const entity& entity) -> void
+			{
+				if (not valid(entity)) return;
+
+				const auto id = component_id<T>();
+
+				if (not has<T>(entity)) return;
+
+				auto& record = m_records[entity.m_index];
+				auto& destination_edge = record.m_archetype->m_remove_edges[id];
+
+				if (not destination_edge)
+				{
+					auto signature = record.m_archetype->m_signature;
+					std::erase(signature, id);
+
+					destination_edge = find_or_create_archetype(signature, *record.m_archetype, {});
+				}
+
+				move_entity(entity, *destination_edge);
+			}
+
+			// returns nullptr if the entity is stale or has no such component
+			template <typename T>
+			auto get(const entity& entity) -> T*
+			{
+				if (not valid(entity)) return nullptr;
+
+				const auto& record = m_records[entity.m_index];
+				const auto column_index = record.m_archetype->column_index(component_id<T>());
+
+				if (column_index == archetype::s_npos) return nullptr;
+
+				return &static_cast<typed_column<T>&>(*record.m_archetype->m_columns[column_index])
+							.m_components[record.m_row];
+			}
+
+			template <typename T>
+			auto has(const entity& entity) -> bool
+			{
+				return get<T>(entity) != nullptr;
+			}
+
+			// calls the function with the entities and component columns of every matching archetype
+			// function(std::span<const entity>, std::span<Ts>...)
+			template <typename... Ts, typename F>
+			auto query_columns(const F& function) -> void
+			{
+				const auto ids = std::array<component_id_t, sizeof...(Ts)> {component_id<Ts>()...};
+
+				for (auto& archetype : m_archetypes)
+				{
+					if (archetype->m_entities.empty()) continue;
+
+					auto column_indices = std::array<std::size_t, sizeof...(Ts)> {};
+					auto matches = true;
+
+					for (auto i = std::size_t {}; i < ids.size() and matches; i++)
+					{
+						column_indices[i] = archetype->column_index(ids[i]);
+						matches = column_indices[i] != archetype::s_npos;
+					}
+
+					if (not matches) continue;
+
+					[&]<std::size_t... Is>(std::index_sequence<Is...>) {
+						std::invoke(function,
+									std::span<const entity> {archetype->m_entities},
+									std::span<Ts> {static_cast<typed_column<Ts>&>(*archetype->m_columns[column_indices[Is]])
+													   .m_components}...);
+					}(std::index_sequence_for<Ts...> {});
+				}
+			}
+
+			// calls the function with the components of every entity having all of the component types
+			// function(Ts&...)
+			template <typename... Ts, typename F>
+			auto query(const F& function) -> void
+			{
+				query_columns<Ts...>([&function](std::span<const entity> entities, std::span<Ts>... columns) {
+					for (auto i = std::size_t {}; i < entities.size(); i++)
+						std::invoke(function, columns[i]...);
+				});
+			}
+
+		private:
+			struct record
+			{
+				non_owning_ptr<archetype> m_archetype;
+				std::size_t m_row;
+				entity::generation_t m_generation;
+			};
+
+			using column_factory_t = std::function<std::unique_ptr<column>(const component_id_t)>;
+
+			// columns missing from the source archetype are created by the factory
+			auto find_or_create_archetype(const std::vector<component_id_t>&, const archetype& source, const column_factory_t&)
+				-> non_owning_ptr<archetype>;
+			// moves the components the destination archetype shares with the current one, dropping the others
+			auto move_entity(const entity&, archetype& destination) -> void;
+			// removes the row of the archetype, moving its last row into its place
+			auto erase_row(archetype&, const std::size_t row) -> void;
+
+			std::vector<std::unique_ptr<archetype>> m_archetypes;
+			std::map<std::vector<component_id_t>, non_owning_ptr<archetype>> m_archetypes_by_signature;
+
+			std::vector<record> m_records;
+			std::vector<entity::index_t> m_free_records;
+		};
+	}
+}
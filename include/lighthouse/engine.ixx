@@ -5,6 +5,7 @@ export module engine;
 import window;
 import version;
 import renderer;
+import job_system;
 
 import std;
 
@@ -20,6 +21,7 @@ export namespace lh
 		{
 			lh::version m_engine_version {0, 1, 6};
 			lh::version m_renderer_version {1, 3, 250};
+			lh::job_system::create_info m_job_system_create_info {};
 		};
 
 		engine(std::unique_ptr<window>, const create_info& = {});
@@ -31,6 +33,7 @@ export namespace lh
 
 		auto window() -> const window&;
 		auto version() -> version&;
+		auto job_system() -> lh::job_system&;
 
 	private:
 		auto initialize() -> void;
@@ -39,6 +42,7 @@ export namespace lh
 
 		std::unique_ptr<lh::window> m_window;
 		std::unique_ptr<renderer> m_renderer;
+		std::unique_ptr<lh::job_system> m_job_system;
 
 		lh::version m_version;
 	};
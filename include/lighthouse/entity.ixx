@@ -12,6 +12,7 @@ import glm;
 #endif
 
 import node;
+import memory_object_pool;
 import window;
 import lighthouse_utility;
 import geometry;
@@ -21,11 +22,40 @@ import std;
 
 export namespace lh
 {
+	// entities keep their transformation as position, orientation and scale components
+	// changes only mark the node transformation as stale, it is composed when it is needed, or for all entities at once
+	// by compose_pending_transformations, while nodes with arbitrary transformations are decomposed on demand
 	class entity
 	{
 	public:
-		entity(std::shared_ptr<node> = std::make_shared<node>());
+		// when the on change hooks of an entity are called
+		enum class change_notification
+		{
+			// on every change
+			immediate,
+			// once per changed component, by dispatch_deferred_changes
+			deferred
+		};
+
+		entity(std::shared_ptr<node> = make_pooled<node>());
 		entity(const geometry::position_t&, const geometry::normal_t = {}, const geometry::scale_t& = {});
+		// queued entities are referred to by address, so entities and the cameras and lights deriving from them can
+		// neither be copied nor moved, they are held by pointer instead
+		entity(const entity&) = delete;
+		auto operator=(const entity&) -> entity& = delete;
+		entity(entity&&) = delete;
+		auto operator=(entity&&) -> entity& = delete;
+		virtual ~entity();
+
+		// composes the node transformations of every entity changed since their last composition
+		// meant to be called once per frame, before global transformations are updated
+		static auto compose_pending_transformations() -> void;
+		// calls the hooks of every deferred entity changed since the last dispatch, coalescing repeated changes
+		static auto dispatch_deferred_changes() -> void;
+
+		// switching to immediate notification calls the hooks of changes deferred until then
+		auto notification_mode(const change_notification) -> void;
+		auto notification_mode() const -> const change_notification;
 
 		auto position() const -> const geometry::position_t&;
 		auto rotation() const -> const geometry::normal_t;
@@ -48,17 +78,43 @@ export namespace lh
 		auto global_transformation() const -> const geometry::transformation_t;
 
 	protected:
-		virtual auto on_position_change() -> void { reconstruct_node(); };
-		virtual auto on_rotation_change() -> void { reconstruct_node(); };
-		virtual auto on_scale_change() -> void { reconstruct_node(); };
+		virtual auto on_position_change() -> void {};
+		virtual auto on_rotation_change() -> void {};
+		virtual auto on_scale_change() -> void {};
 
 		auto reconstruct_node() const -> void;
+		// decomposes the node transformation into components, if it was set directly since
+		auto decompose_node() const -> void;
+		// marks the node transformation as stale, after a component change
+		auto request_reconstruction() -> void;
+		// calls the hook of the changed component, or defers it
+		auto notify_change(const std::uint8_t) -> void;
+		auto dispatch_changes(const std::uint8_t) -> void;
 
-		geometry::position_t m_position;
-		geometry::rotation_t m_orientation;
-		geometry::scale_t m_scale;
+		static inline constexpr auto s_position_change = std::uint8_t {1};
+		static inline constexpr auto s_rotation_change = std::uint8_t {2};
+		static inline constexpr auto s_scale_change = std::uint8_t {4};
+
+		// components are derived from the node transformation on demand
+		mutable geometry::position_t m_position;
+		mutable geometry::rotation_t m_orientation;
+		mutable geometry::scale_t m_scale;
 
 		mutable bool m_node_requires_reconstruction;
+		mutable bool m_components_require_decomposition;
+		// position within the queue of the next batched composition, if listed
+		std::size_t m_reconstruction_queue_index;
+		change_notification m_change_notification;
+		// components changed since the last dispatch, in deferred mode, and the position within the dispatch queue
+		std::uint8_t m_deferred_changes;
+		std::size_t m_change_queue_index;
 		std::shared_ptr<lh::node> m_node;
+
+	private:
+		static inline constexpr auto s_not_queued = std::numeric_limits<std::size_t>::max();
+
+		// entities destroyed while queued leave null entries behind, so that leaving the queue takes constant time
+		static inline std::vector<entity*> s_pending_reconstructions {};
+		static inline std::vector<entity*> s_changed_entities {};
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,61 @@
+module;
+
+#if INTELLISENSE
+#include "glm/mat4x4.hpp"
+#endif
+
+export module frustum;
+
+import geometry;
+
+#if not INTELLISENSE
+import glm;
+#endif
+
+import std;
+
+export namespace lh
+{
+	namespace geometry
+	{
+		// volume enclosed by six inward facing planes, points are inside when dot(normal, point) + distance >= 0
+		struct frustum
+		{
+			enum class side
+			{
+				left,
+				right,
+				bottom,
+				top,
+				near_side,
+				far_side,
+				side_count
+			};
+
+			frustum();
+			// planes of the clip volume of a projection * view transformation, in world space
+			// the depth range is zero to one, as with the projections of cameras
+			frustum(const transformation_t& view_projection);
+
+			auto contains(const position_t&) const -> bool;
+			// conservative, volumes close to the frustum corners can pass while lying outside of it
+			auto intersects(const sphere&) const -> bool;
+			auto intersects(const aabb&) const -> bool;
+
+			auto plane(const side) const -> const geometry::plane&;
+
+			std::array<geometry::plane, std::to_underlying(side::side_count)> m_planes;
+		};
+
+		// batched tests write the indices of visible volumes to the front of the visible span, in their original order
+		// the visible span needs to hold as many indices as there are volumes, the count of visible ones is returned
+		// volumes are tested several at a time without branches, so that the tests vectorize
+		auto cull(const frustum&, std::span<const sphere>, std::span<std::uint32_t> visible) -> std::size_t;
+		auto cull(const frustum&, std::span<const aabb>, std::span<std::uint32_t> visible) -> std::size_t;
+		// tests the bounds of a mesh, placed by each of the instance transformations
+		auto cull(const frustum&,
+				  const aabb& mesh_bounds,
+				  std::span<const transformation_t> instances,
+				  std::span<std::uint32_t> visible) -> std::size_t;
+	}
+}
@@ -24,6 +24,7 @@ export namespace lh
 	{
 		using scalar_t = lh::float32_t;
 		constexpr auto epsilon = std::numeric_limits<scalar_t>::epsilon();
+		constexpr auto infinity = std::numeric_limits<scalar_t>::infinity();
 
 		using vec3_t = glm::vec<3, scalar_t>;
 		using vec4_t = glm::vec<4, scalar_t>;
@@ -105,5 +106,14 @@ export namespace lh
 			position_t m_position;
 			normal_t m_direction;
 		};
+
+		// composes scale * rotation * translation, the order entities combine their components in
+		auto compose_transformation(const position_t&, const quaternion_t&, const scale_t&) -> const transformation_t;
+		// composes transformations of many components at once, in a branchless loop over separate component arrays
+		// every span needs to be as long as the transformation span
+		auto compose_transformations(std::span<const position_t>,
+									 std::span<const quaternion_t>,
+									 std::span<const scale_t>,
+									 std::span<transformation_t>) -> void;
 	}
 }
\ No newline at end of file
@@ -0,0 +1,113 @@
+module;
+
+export module job_system;
+
+import std;
+
+export namespace lh
+{
+	// work stealing thread pool
+	// every worker owns a job queue, it pops its own jobs from the back and steals from the front of other queues
+	// threads waiting for a group of jobs help executing jobs instead of blocking
+	class job_system
+	{
+	public:
+		using job_t = std::function<void()>;
+
+		struct create_info
+		{
+			// worker threads in addition to the threads submitting jobs
+			std::size_t m_thread_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+		};
+
+		// number of unfinished jobs submitted with it
+		class counter
+		{
+		public:
+			auto done() const -> bool;
+
+		private:
+			friend job_system;
+
+			std::atomic<std::size_t> m_pending_jobs {};
+		};
+
+		job_system(const create_info& = {});
+		job_system(const job_system&) = delete;
+		auto operator=(const job_system&) -> job_system& = delete;
+		job_system(job_system&&) = delete;
+		auto operator=(job_system&&) -> job_system& = delete;
+		~job_system();
+
+		auto submit(job_t, counter&) -> void;
+		// executes queued jobs until every job of the counter is finished
+		auto wait(counter&) -> void;
+
+		// calls the function with consecutive index ranges [first, last) covering [0, count)
+		// ranges are at least grain sized and are determined by the count and grain alone
+		// the calling thread processes the first range and helps with the rest
+		template <typename F>
+		auto parallel_for(const std::size_t count, const std::size_t grain, const F& function) -> void
+		{
+			if (count == 0) return;
+
+			const auto range_size = std::max(grain, std::size_t {1});
+			const auto range_count = (count + range_size - 1) / range_size;
+
+			if (range_count == 1 or thread_count() == 0)
+			{
+				for (auto first = std::size_t {}; first < count; first += range_size)
+					std::invoke(function, first, std::min(first + range_size, count));
+
+				return;
+			}
+
+			auto counter = job_system::counter {};
+
+			for (auto i = range_count - 1; i > 0; i--)
+			{
+				const auto first = i * range_size;
+				const auto last = std::min(first + range_size, count);
+
+				submit([&function, first, last]() { std::invoke(function, first, last); }, counter);
+			}
+
+			std::invoke(function, std::size_t {}, range_size);
+
+			wait(counter);
+		}
+
+		auto thread_count() const -> const std::size_t;
+
+	private:
+		struct job
+		{
+			job_t m_function;
+			counter* m_counter;
+		};
+
+		struct job_queue
+		{
+			std::mutex m_mutex;
+			std::deque<job> m_jobs;
+		};
+
+		auto work(std::stop_token, const std::size_t queue_index) -> void;
+		// pops a job from the given queue, or steals one from the others, returning false if all are empty
+		auto try_execute(const std::size_t queue_index) -> bool;
+		auto execute(job&) -> void;
+		// workers use their own queues, every other thread shares the last one
+		auto current_queue_index() const -> std::size_t;
+
+		std::vector<std::unique_ptr<job_queue>> m_queues;
+		std::atomic<std::size_t> m_queued_jobs;
+
+		std::mutex m_sleep_mutex;
+		std::condition_variable_any m_wake_condition;
+
+		std::vector<std::jthread> m_threads;
+
+		static inline thread_local const job_system* s_worker_owner = nullptr;
+		static inline thread_local std::size_t s_worker_queue_index = 0;
+	};
+}
@@ -0,0 +1,173 @@
+module;
+
+#if INTELLISENSE
+#include "glm/vec3.hpp"
+#endif
+
+export module linear_bvh;
+
+import geometry;
+import bounding_volume;
+import frustum;
+import job_system;
+
+#if not INTELLISENSE
+import glm;
+#endif
+
+import std;
+
+export namespace lh
+{
+	namespace geometry
+	{
+		// bounding volume hierarchy over the bounds of many moving objects, such as instances, rebuilt every frame
+		// objects are sorted along a morton curve through their centers, the hierarchy then follows from the sorted
+		// codes alone, built bottom up in a single walk from the objects to the root, see apetrei 2014
+		// between rebuilds, refitting keeps the hierarchy and only recomputes the bounds of its nodes
+		// queries report the index the bounds had when building, not their position within the hierarchy
+		class linear_bvh
+		{
+		public:
+			enum class precision
+			{
+				// 30 bit codes, 10 bits per axis, packed with the index of their object, sorted in three passes
+				low,
+				// 63 bit codes, 21 bits per axis, sorted in up to six passes, for scenes with a large extent
+				high
+			};
+
+			struct create_info
+			{
+				precision m_precision = precision::low;
+				// number of objects processed by a single job, when building and refitting
+				std::size_t m_grain = 16384;
+			};
+
+			// interior nodes come first, each one splitting the sorted objects behind its index, followed by a leaf for
+			// each sorted object, leaves have no children and hold the index of their object as their right child
+			struct node
+			{
+				auto leaf() const -> bool { return m_left == s_leaf; }
+
+				aabb m_bounds;
+				std::uint32_t m_left;
+				std::uint32_t m_right;
+			};
+
+			linear_bvh(const create_info& = {});
+
+			auto build(std::span<const aabb>, job_system&) -> void;
+			// the bounds need to be given in the same order and number as when building
+			// the hierarchy degrades as objects move away from where they were when building, so rebuild regularly
+			auto refit(std::span<const aabb>, job_system&) -> void;
+
+			// queries call the function with the index of every object whose bounds intersect the volume
+			// function(const std::uint32_t), objects are visited once and in no particular order
+			template <typename F>
+			auto query(const aabb& volume, const F& function) const -> void
+			{
+				visit([&volume](const aabb& bounds) { return intersects(volume, bounds); }, function);
+			}
+
+			template <typename F>
+			auto query(const sphere& volume, const F& function) const -> void
+			{
+				visit([&volume](const aabb& bounds) { return intersects(volume, bounds); }, function);
+			}
+
+			template <typename F>
+			auto query(const frustum& volume, const F& function) const -> void
+			{
+				visit([&volume](const aabb& bounds) { return volume.intersects(bounds); }, function);
+			}
+
+			// objects whose bounds the ray enters before reaching the distance
+			template <typename F>
+			auto query(const ray& ray,
+					   const F& function,
+					   const scalar_t max_distance = std::numeric_limits<scalar_t>::infinity()) const -> void
+			{
+				visit([&ray, max_distance](const aabb& bounds) { return intersects(ray, bounds, max_distance); },
+					  function);
+			}
+
+			auto bounds() const -> const aabb&;
+			auto nodes() const -> std::span<const node>;
+			auto root() const -> const std::uint32_t;
+			auto size() const -> const std::size_t;
+
+		private:
+			static inline constexpr auto s_leaf = std::numeric_limits<std::uint32_t>::max();
+			// objects with equal codes are told apart by their sorted index, every level of the hierarchy splits off
+			// at least one more bit of either, so it is no deeper than the bits of both
+			static inline constexpr auto s_max_depth = std::size_t {64 + 32};
+			static inline constexpr auto s_radix_bits = std::size_t {11};
+			static inline constexpr auto s_radix_size = std::size_t {1} << s_radix_bits;
+
+			using code_t = std::uint64_t;
+
+			template <typename T, typename F>
+			auto visit(const T& test, const F& function) const -> void
+			{
+				if (m_nodes.empty()) return;
+
+				auto stack = std::array<std::uint32_t, s_max_depth + 1> {};
+				auto stack_size = std::size_t {};
+
+				stack[stack_size++] = m_root;
+
+				while (stack_size != 0)
+				{
+					const auto& node = m_nodes[stack[--stack_size]];
+
+					if (not test(node.m_bounds)) continue;
+
+					if (node.leaf())
+					{
+						function(node.m_right);
+						continue;
+					}
+
+					stack[stack_size++] = node.m_right;
+					stack[stack_size++] = node.m_left;
+				}
+			}
+
+			auto compute_codes(std::span<const aabb>, job_system&) -> void;
+			auto sort_codes(job_system&) -> void;
+			// builds the hierarchy from the sorted codes along with the bounds of its nodes
+			auto link_nodes(std::span<const aabb>, job_system&) -> void;
+			auto refit_nodes(std::span<const aabb>, job_system&) -> void;
+			// length of the common prefix of two sorted codes, along with their indices if the codes are equal
+			auto common_prefix(const std::size_t, const std::size_t) const -> std::int32_t;
+			// low precision codes hold the index of their object in their lower half, so that sorting moves codes alone
+			auto packed_indices() const -> bool;
+			auto block_count() const -> std::size_t;
+
+			create_info m_create_info;
+
+			std::vector<node> m_nodes;
+			// parent of every node, the root being its own parent
+			std::vector<std::uint32_t> m_parents;
+			std::uint32_t m_root;
+			// one more than the common prefix of each sorted code with the one before it, the ends of the codes being
+			// zero, so that building compares neighbouring ranges without touching their codes
+			std::vector<std::uint8_t> m_prefixes;
+
+			// centers of the objects, quantized into codes
+			std::vector<position_t> m_centers;
+			// codes and object indices, sorted by code after building, along with the buffers used while sorting
+			// object indices are left empty when packed into the codes
+			std::vector<code_t> m_codes;
+			std::vector<std::uint32_t> m_indices;
+			std::vector<code_t> m_sorted_codes;
+			std::vector<std::uint32_t> m_sorted_indices;
+			// digit counts of each block of objects, then the offsets each block scatters its digits to
+			std::vector<std::array<std::uint32_t, s_radix_size>> m_block_digits;
+			// interior nodes are finished by the second of their children to reach them, the first one stops there
+			// the end of the range of objects covered by the first child when building, a count of them when refitting
+			std::vector<std::atomic<std::uint32_t>> m_visits;
+		};
+	}
+}
@@ -0,0 +1,62 @@
+module;
+
+export module memory_allocation_statistics;
+
+import data_type;
+
+import std;
+
+export namespace lh
+{
+	// snapshot of the state of a suballocator
+	struct allocation_statistics
+	{
+		// bucket i counts suballocations of sizes within [2^i, 2^(i + 1))
+		using allocation_size_histogram_t = std::array<std::size_t, std::numeric_limits<std::size_t>::digits>;
+
+		// fraction of free memory not held by the largest free memory block
+		// 0 when all free memory is contiguous, approaching 1 as it gets scattered across small blocks
+		auto fragmentation() const -> const float01_t;
+
+		std::size_t m_reserved_bytes {};
+		std::size_t m_used_bytes {};
+		std::size_t m_free_bytes {};
+		std::size_t m_peak_used_bytes {};
+
+		std::size_t m_largest_free_block_bytes {};
+		std::size_t m_free_block_count {};
+
+		// currently live suballocations
+		std::size_t m_allocation_count {};
+		// suballocations and releases over the lifetime of the suballocator
+		std::size_t m_total_allocation_count {};
+		std::size_t m_total_free_count {};
+		// bytes skipped over to align suballocations, over the lifetime of the suballocator
+		// padding returns to the free memory once skipped, so this is not memory currently lost to alignment
+		std::size_t m_total_alignment_padding_bytes {};
+
+		allocation_size_histogram_t m_allocation_size_histogram {};
+	};
+
+	// constant time bookkeeping of suballocation events, embedded into suballocators
+	class allocation_counters
+	{
+	public:
+		// used bytes after the suballocation, to keep track of peak usage
+		auto record_allocation(const std::size_t size, const std::size_t used_bytes) -> void;
+		auto record_free(const std::size_t count = 1) -> void;
+
+		// currently live suballocations
+		auto allocation_count() const -> const std::size_t;
+
+		// fills in the counted fields, memory layout fields are left to the suballocator
+		auto fill(allocation_statistics&) const -> void;
+
+	private:
+		std::size_t m_peak_used_bytes {};
+		std::size_t m_total_allocation_count {};
+		std::size_t m_total_free_count {};
+
+		allocation_statistics::allocation_size_histogram_t m_allocation_size_histogram {};
+	};
+}
@@ -7,6 +7,7 @@ export namespace lh
 		first_fit,
 		best_fit,
 		worst_fit,
+		tlsf,
 		default_strategy = first_fit
 	};
 }
\ No newline at end of file
@@ -0,0 +1,116 @@
+module;
+
+export module memory_frame_arena;
+
+import allocation_strategy;
+import memory_block;
+import memory_heap;
+import memory_allocation_statistics;
+
+import std;
+
+export namespace lh
+{
+	// linear allocator, suballocations are claimed by bumping an offset
+	// individual suballocations are never freed, the whole arena is reclaimed at once by a constant time reset
+	// suballocations exceeding the arena are served from overflow blocks, which are released on reset
+	// and folded into the arena so that subsequent frames fit
+	class frame_arena
+	{
+	public:
+		frame_arena(const std::size_t);
+
+		// disallow copy construction
+		frame_arena(const frame_arena&) = delete;
+		auto operator=(const frame_arena&) -> frame_arena& = delete;
+
+		frame_arena(frame_arena&&) noexcept;
+		auto operator=(frame_arena&&) noexcept -> frame_arena&;
+
+		~frame_arena();
+
+		[[nodiscard]] auto request_and_commit_suballocation(const std::size_t,
+															const std::size_t = alignof(std::max_align_t)) -> void*;
+		// memory is only reclaimed on reset
+		auto free_suballocation(const memory_block&) -> void;
+
+		// invalidates all suballocations
+		auto reset() -> void;
+
+		auto size() const -> const std::size_t;
+		auto used_memory_bytes() const -> const std::size_t;
+		auto peak_memory_bytes() const -> const std::size_t;
+		auto statistics() const -> const allocation_statistics;
+
+	private:
+		auto release_overflow_blocks() -> void;
+
+		std::byte* m_memory;
+		std::size_t m_size;
+		std::size_t m_offset;
+		std::size_t m_peak_bytes;
+
+		std::vector<void*> m_overflow_blocks;
+		std::size_t m_overflow_bytes;
+
+		allocation_counters m_allocation_counters;
+	};
+
+	// stateful allocator adaptor, allowing standard containers to live in a frame arena
+	template <typename T>
+	using frame_allocator = heap_allocator<T, allocation_strategy::default_strategy, frame_arena>;
+
+	template <typename T>
+	using frame_vector = std::vector<T, frame_allocator<T>>;
+
+	using frame_string = std::basic_string<char, std::char_traits<char>, frame_allocator<char>>;
+
+	// ==========================================================================
+
+	// ring of N frame arenas, one for each frame in flight
+	// memory claimed during a frame remains valid until the same arena comes around again
+	template <std::size_t N = 2>
+	class buffered_frame_arena
+	{
+	public:
+		static_assert(N > 0, "buffered frame arena requires at least one frame arena");
+
+		static inline constexpr auto s_frame_count = N;
+
+		buffered_frame_arena(const std::size_t size)
+			: m_frame_arenas {[size]<std::size_t... Is>(std::index_sequence<Is...>) {
+				  return std::array<frame_arena, N> {((void)Is, frame_arena {size})...};
+			  }(std::make_index_sequence<N> {})},
+			  m_current_frame {}
+		{}
+
+		// advance to the next frame arena and reset it
+		// needs to be called once per frame, once the frame that last used it has completed
+		auto next_frame() -> void
+		{
+			m_current_frame = (m_current_frame + 1) % N;
+			m_frame_arenas[m_current_frame].reset();
+		}
+
+		// position of the current frame within the ring, for resources buffered alongside the arenas
+		auto frame_index() const -> std::size_t { return m_current_frame; }
+		auto current() -> frame_arena& { return m_frame_arenas[m_current_frame]; }
+		auto current() const -> const frame_arena& { return m_frame_arenas[m_current_frame]; }
+
+		template <typename T>
+		auto allocator() -> frame_allocator<T>
+		{
+			return frame_allocator<T> {current()};
+		}
+
+		template <typename T, typename... Ts>
+		auto vector(Ts&&... ts) -> frame_vector<T>
+		{
+			return frame_vector<T>(std::forward<Ts>(ts)..., allocator<T>());
+		}
+
+	private:
+		std::array<frame_arena, N> m_frame_arenas;
+		std::size_t m_current_frame;
+	};
+}
@@ -3,7 +3,9 @@ module;
 export module memory_heap;
 
 import allocation_strategy;
+import memory_block;
 import memory_suballocator;
+import memory_allocation_statistics;
 import output;
 
 import std;
@@ -11,8 +13,10 @@ import std;
 export namespace lh
 {
 	// stateful allocator
-	// claims memory from a memory suballocator
-	template <typename T, lh::allocation_strategy A = lh::allocation_strategy::default_strategy>
+	// claims memory from a memory suballocator, or any other type exposing the same suballocation interface
+	template <typename T,
+			  lh::allocation_strategy A = lh::allocation_strategy::default_strategy,
+			  typename S = lh::memory_suballocator<A>>
 	class heap_allocator
 	{
 	public:
@@ -22,27 +26,29 @@ export namespace lh
 		using propagate_on_container_swap = std::true_type;
 		using is_always_equal = std::true_type;
 
-		template <typename, lh::allocation_strategy>
+		template <typename, lh::allocation_strategy, typename>
 		friend class heap_allocator;
 
 		template <typename Y>
 		struct rebind
 		{
-			using other = heap_allocator<Y, A>;
+			using other = heap_allocator<Y, A, S>;
 		};
 
-		heap_allocator(lh::memory_suballocator<A>& memory_suballocator) : m_memory_suballocator {&memory_suballocator}
+		heap_allocator(S& memory_suballocator) : m_memory_suballocator {&memory_suballocator}
 		{}
 		template <class Y>
-		heap_allocator(const heap_allocator<Y>& other) noexcept : m_memory_suballocator {other.m_memory_suballocator}
+		heap_allocator(const heap_allocator<Y, A, S>& other) noexcept : m_memory_suballocator {other.m_memory_suballocator}
 		{}
 
 		auto select_on_container_copy_construction() const -> heap_allocator { return *this; }
 
+		// suballocations are aligned to the alignment requirement of T, over-aligned types included
 		T* allocate(const size_t element_count) noexcept
 		{
 			const auto suballocation = m_memory_suballocator->request_and_commit_suballocation(element_count *
-																							   sizeof (T));
+																								   sizeof(T),
+																							   alignof(T));
 			return static_cast<T*>(suballocation);
 		}
 
@@ -53,82 +59,223 @@ export namespace lh
 		}
 
 	private:
-		lh::memory_suballocator<A>* m_memory_suballocator;
+		S* m_memory_suballocator;
 	};
 
 	// ==========================================================================
 
-	// fixed size memory pool
+	// memory pool, claiming memory in chunks
+	// each chunk is managed by its own memory suballocator
+	// growing the pool appends new chunks, addresses of existing suballocations remain stable
 	template <lh::allocation_strategy A = lh::allocation_strategy::default_strategy>
 	class memory_pool
 	{
 	public:
-		memory_pool(const std::size_t size) : m_memory {std::malloc(size)}, m_size {size}, m_suballocator {m_memory, {0, size}}
+		enum class growth_strategy
 		{
-			assert_allocation_success(size);
+			// the pool is made up of a single chunk and fails suballocations once it runs dry
+			fixed,
+			// a new chunk is appended whenever the pool runs dry
+			chunked
+		};
+
+		struct create_info
+		{
+			growth_strategy m_growth_strategy = growth_strategy::chunked;
+			// size of appended chunks, 0 reuses the initial pool size
+			std::size_t m_chunk_size = 0;
+		};
+
+		template <typename T>
+		using allocator_t = heap_allocator<T, A, memory_pool>;
+
+		template <typename T>
+		using vector_t = std::vector<T, allocator_t<T>>;
+
+		memory_pool(const std::size_t size, const create_info& create_info = {})
+			: m_create_info {create_info}, m_chunks {}, m_reserved_bytes {}, m_peak_used_bytes {}
+		{
+			if (m_create_info.m_chunk_size == 0) m_create_info.m_chunk_size = size;
+
+			append_chunk(size);
 		}
 
 		// disallow copy construction
 		memory_pool(const memory_pool&) = delete;
 		auto operator=(const memory_pool&) -> memory_pool& = delete;
 
-		memory_pool(memory_pool&& other) noexcept
-			: m_memory {std::exchange(other.m_memory, {})},
-			  m_size {std::exchange(other.m_size, {})},
-			  m_suballocator {std::exchange(other.m_suballocator, {})}
-		{}
-		auto operator=(memory_pool&& other) noexcept -> memory_pool&
+		memory_pool(memory_pool&&) noexcept = default;
+		auto operator=(memory_pool&&) noexcept -> memory_pool& = default;
+
+		[[nodiscard]] auto request_and_commit_suballocation(const std::size_t size, const std::size_t alignment = 1)
+			-> void*
+		{
+			// most recently appended chunks are the most likely to have free memory
+			for (auto& chunk : std::ranges::reverse_view {m_chunks})
+				if (const auto suballocation = chunk->m_suballocator.request_and_commit_suballocation(size, alignment))
+				{
+					m_peak_used_bytes = std::max(m_peak_used_bytes, used_memory_bytes());
+					return suballocation;
+				}
+
+			if (m_create_info.m_growth_strategy == growth_strategy::fixed)
+			{
+				lh::output::warning() << "fixed memory pool of: " << m_reserved_bytes
+									  << " bytes could not suballocate: " << size << " bytes";
+				return nullptr;
+			}
+
+			// the new chunk is guaranteed to fit the request, alignment padding included
+			// rounding up to a power of two accounts for strategies which round requests up to size classes
+			if (alignment > s_max_chunk_size - sizeof(std::max_align_t) or
+				size > s_max_chunk_size - sizeof(std::max_align_t) - alignment)
+			{
+				lh::output::error() << "memory pool can not grow to fit: " << size << " bytes with an alignment of: "
+									<< alignment;
+				return nullptr;
+			}
+
+			if (not append_chunk(std::max(m_create_info.m_chunk_size,
+										  std::bit_ceil(size + alignment + sizeof(std::max_align_t)))))
+				return nullptr;
+
+			const auto suballocation = m_chunks.back()->m_suballocator.request_and_commit_suballocation(size, alignment);
+			m_peak_used_bytes = std::max(m_peak_used_bytes, used_memory_bytes());
+
+			return suballocation;
+		}
+
+		auto free_suballocation(const memory_block& memory_block) -> void
+		{
+			const auto address = static_cast<std::uintptr_t>(memory_block.m_offset);
+
+			for (auto& chunk : m_chunks)
+				if (address >= chunk->m_suballocator.address() and
+					address < chunk->m_suballocator.address() + chunk->m_size)
+				{
+					chunk->m_suballocator.free_suballocation(memory_block);
+					return;
+				}
+
+			lh::output::warning() << "memory pool does not own the address: " << address;
+		}
+
+		auto chunk_count() const -> const std::size_t { return m_chunks.size(); }
+		auto reserved_bytes() const -> const std::size_t { return m_reserved_bytes; }
+		auto used_memory_bytes() const -> const std::size_t
 		{
-			m_memory = std::exchange(other.m_memory, {});
-			m_size = std::exchange(other.m_size, {});
-			m_suballocator = std::exchange(other.m_suballocator, {});
+			auto result = std::size_t {};
+
+			for (const auto& chunk : m_chunks)
+				result += chunk->m_suballocator.used_memory_bytes();
 
-			return *this;
+			return result;
 		}
 
-		~memory_pool()
+		// combined statistics of all chunks
+		auto statistics() const -> const allocation_statistics
 		{
-			if (m_memory) std::free(m_memory);
+			auto result = allocation_statistics {.m_reserved_bytes = m_reserved_bytes};
+
+			for (const auto& chunk : m_chunks)
+			{
+				const auto statistics = chunk->m_suballocator.statistics();
+
+				result.m_used_bytes += statistics.m_used_bytes;
+				result.m_free_bytes += statistics.m_free_bytes;
+				result.m_total_alignment_padding_bytes += statistics.m_total_alignment_padding_bytes;
+				result.m_largest_free_block_bytes = std::max(result.m_largest_free_block_bytes,
+															 statistics.m_largest_free_block_bytes);
+				result.m_free_block_count += statistics.m_free_block_count;
+				result.m_allocation_count += statistics.m_allocation_count;
+				result.m_total_allocation_count += statistics.m_total_allocation_count;
+				result.m_total_free_count += statistics.m_total_free_count;
+
+				for (auto i = std::size_t {}; i < result.m_allocation_size_histogram.size(); i++)
+					result.m_allocation_size_histogram[i] += statistics.m_allocation_size_histogram[i];
+			}
+
+			result.m_peak_used_bytes = m_peak_used_bytes;
+
+			return result;
 		}
 
-		auto size() const -> const std::size_t { return m_size; }
-		auto data() -> void* { return m_memory; }
-		auto resize(const std::size_t new_size)
+		// reserve memory up front by appending a chunk, existing suballocations are unaffected
+		auto reserve(const std::size_t new_size) -> void
 		{
-			if (new_size <= m_size)
+			if (new_size <= m_reserved_bytes)
 			{
-				lh::output::warning() << "resizing memory pool requires a size larger than: " << m_size;
+				lh::output::warning() << "reserving memory pool requires a size larger than: " << m_reserved_bytes;
 				return;
 			}
 
-			m_memory = std::realloc(new_size);
-			assert_allocation_success(new_size);
-			m_size = new_size;
-			m_suballocator = {m_memory, {0, m_size}};
-		}
+			if (m_create_info.m_growth_strategy == growth_strategy::fixed)
+			{
+				lh::output::warning() << "fixed memory pools can not be grown";
+				return;
+			}
 
-		auto suballocator() -> lh::memory_suballocator<A>& { return m_suballocator; }
+			append_chunk(new_size - m_reserved_bytes);
+		}
 
 		template <typename T>
-		auto allocator() -> heap_allocator<T>
+		auto allocator() -> allocator_t<T>
 		{
-			return heap_allocator<T, A> {m_suballocator};
+			return allocator_t<T> {*this};
 		}
 
 		template <typename T, typename... Ts>
-		auto vector(auto&&... ts)
+		auto vector(Ts&&... ts) -> vector_t<T>
 		{
-			return std::vector<T, heap_allocator<T>> {std::forward<Ts>(ts)..., {m_suballocator}};
+			return vector_t<T>(std::forward<Ts>(ts)..., allocator<T>());
 		}
 
 	private:
-		auto assert_allocation_success(const std::size_t size) const -> void
+		// largest power of two a chunk size can be rounded up to
+		static inline constexpr auto s_max_chunk_size = std::size_t {1}
+														<< (std::numeric_limits<std::size_t>::digits - 1);
+
+		struct chunk
 		{
-			if (not m_memory) lh::output::error() << "could not allocate: " << size << " bytes for memory pooling";
+			chunk(const std::size_t size)
+				: m_memory {std::malloc(size)}, m_size {size}, m_suballocator {m_memory, {0, size}}
+			{}
+
+			chunk(const chunk&) = delete;
+			auto operator=(const chunk&) -> chunk& = delete;
+
+			~chunk()
+			{
+				if (m_memory) std::free(m_memory);
+			}
+
+			void* m_memory;
+			std::size_t m_size;
+			lh::memory_suballocator<A> m_suballocator;
+		};
+
+		// returns whether the chunk could be allocated
+		auto append_chunk(const std::size_t size) -> bool
+		{
+			auto new_chunk = std::make_unique<chunk>(size);
+
+			if (not new_chunk->m_memory)
+			{
+				lh::output::error() << "could not allocate: " << size << " bytes for memory pooling";
+				return false;
+			}
+
+			m_reserved_bytes += size;
+			m_chunks.push_back(std::move(new_chunk));
+
+			return true;
 		}
 
-		void* m_memory;
-		std::size_t m_size;
-		lh::memory_suballocator<A> m_suballocator;
+		create_info m_create_info;
+
+		// chunks are individually allocated so that their suballocators never move
+		std::vector<std::unique_ptr<chunk>> m_chunks;
+		std::size_t m_reserved_bytes;
+		std::size_t m_peak_used_bytes;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,254 @@
+module;
+
+export module memory_object_pool;
+
+import std;
+
+export namespace lh
+{
+	// pool of fixed size objects of type T
+	// objects are stored in slab pages, page addresses never change so object addresses remain stable
+	// released slots are linked into an intrusive free list and reused by the next creation
+	// handles carry a generation, which is bumped on destruction so that stale handles can be detected
+	template <typename T>
+	class object_pool
+	{
+	public:
+		using index_t = std::uint32_t;
+		using generation_t = std::uint32_t;
+
+		struct create_info
+		{
+			// number of objects stored by each slab page
+			index_t m_objects_per_page = 64;
+		};
+
+		struct handle
+		{
+			auto operator==(const handle&) const -> bool = default;
+
+			index_t m_index = std::numeric_limits<index_t>::max();
+			generation_t m_generation = 0;
+		};
+
+		object_pool(const create_info& create_info = {})
+			: m_create_info {create_info}, m_pages {}, m_free_slot {s_null_slot}, m_size {}
+		{
+			if (m_create_info.m_objects_per_page == 0) m_create_info.m_objects_per_page = 1;
+		}
+
+		// disallow copy and move construction, handles and storage handed out refer back to the pool
+		object_pool(const object_pool&) = delete;
+		auto operator=(const object_pool&) -> object_pool& = delete;
+		object_pool(object_pool&&) = delete;
+		auto operator=(object_pool&&) -> object_pool& = delete;
+
+		~object_pool()
+		{
+			for_each_slot([](slot& slot) {
+				if (slot.m_alive) slot.object()->~T();
+			});
+		}
+
+		// pool used by pool_allocator, constructed on first use
+		// it is never destroyed, so that storage released during static destruction still has a pool to return to
+		static auto global() -> object_pool&
+		{
+			static auto& pool = *new object_pool<T> {};
+
+			return pool;
+		}
+
+		template <typename... Ts>
+		auto create(Ts&&... ts) -> handle
+		{
+			const auto index = acquire_slot();
+			auto& slot = slot_at(index);
+
+			try
+			{
+				std::construct_at(slot.object(), std::forward<Ts>(ts)...);
+			}
+			catch (...)
+			{
+				release_slot(index);
+				throw;
+			}
+
+			slot.m_alive = true;
+			m_size++;
+
+			return {index, slot.m_generation};
+		}
+
+		auto destroy(const handle& handle) -> void
+		{
+			if (not valid(handle)) return;
+
+			auto& slot = slot_at(handle.m_index);
+
+			std::destroy_at(slot.object());
+			slot.m_alive = false;
+			m_size--;
+
+			release_slot(handle.m_index);
+		}
+
+		// returns nullptr for stale handles
+		auto get(const handle& handle) const -> T*
+		{
+			if (not valid(handle)) return nullptr;
+
+			return slot_at(handle.m_index).object();
+		}
+
+		auto valid(const handle& handle) const -> bool
+		{
+			if (handle.m_index >= capacity()) return false;
+
+			const auto& slot = slot_at(handle.m_index);
+
+			return slot.m_alive and slot.m_generation == handle.m_generation;
+		}
+
+		// uninitialized storage for a single object, released by its address rather than a handle
+		// the object is managed by the caller, so it is neither counted nor visited by the pool
+		auto allocate() -> T*
+		{
+			return slot_at(acquire_slot()).object();
+		}
+
+		auto deallocate(T* object) -> void
+		{
+			// the storage is the first member of its slot
+			release_slot(reinterpret_cast<slot*>(object)->m_index);
+		}
+
+		// visits live objects in storage order
+		template <typename F>
+		auto for_each(const F& function) -> void
+		{
+			for_each_slot([&function](slot& slot) {
+				if (slot.m_alive) std::invoke(function, *slot.object());
+			});
+		}
+
+		auto size() const -> const std::size_t { return m_size; }
+		auto capacity() const -> const std::size_t { return m_pages.size() * m_create_info.m_objects_per_page; }
+
+	private:
+		static inline constexpr auto s_null_slot = std::numeric_limits<index_t>::max();
+
+		struct slot
+		{
+			auto object() -> T* { return std::launder(reinterpret_cast<T*>(m_storage)); }
+
+			alignas(T) std::byte m_storage[sizeof(T)];
+			generation_t m_generation;
+			index_t m_index;
+			// intrusive free list link, only meaningful while the slot is free
+			index_t m_next_free;
+			bool m_alive;
+		};
+
+		auto slot_at(const index_t index) const -> slot&
+		{
+			const auto objects_per_page = m_create_info.m_objects_per_page;
+
+			return m_pages[index / objects_per_page][index % objects_per_page];
+		}
+
+		template <typename F>
+		auto for_each_slot(const F& function) -> void
+		{
+			for (auto& page : m_pages)
+				for (auto& slot : std::span {page.get(), m_create_info.m_objects_per_page})
+					std::invoke(function, slot);
+		}
+
+		auto acquire_slot() -> index_t
+		{
+			if (m_free_slot == s_null_slot) append_page();
+
+			const auto index = m_free_slot;
+			m_free_slot = slot_at(index).m_next_free;
+
+			return index;
+		}
+
+		auto release_slot(const index_t index) -> void
+		{
+			auto& slot = slot_at(index);
+
+			slot.m_generation++;
+			slot.m_next_free = m_free_slot;
+			m_free_slot = index;
+		}
+
+		// new slots are linked in ascending order, so that objects are created in storage order
+		auto append_page() -> void
+		{
+			const auto objects_per_page = m_create_info.m_objects_per_page;
+			const auto first_index = static_cast<index_t>(capacity());
+
+			auto& page = m_pages.emplace_back(std::make_unique_for_overwrite<slot[]>(objects_per_page));
+
+			for (auto i = index_t {}; i < objects_per_page; i++)
+			{
+				page[i].m_generation = 0;
+				page[i].m_index = first_index + i;
+				page[i].m_next_free = i + 1 < objects_per_page ? first_index + i + 1 : m_free_slot;
+				page[i].m_alive = false;
+			}
+
+			m_free_slot = first_index;
+		}
+
+		create_info m_create_info;
+
+		std::vector<std::unique_ptr<slot[]>> m_pages;
+		index_t m_free_slot;
+		std::size_t m_size;
+	};
+
+	// allocator drawing single objects from the global pool of their type, other requests use the default allocator
+	template <typename T>
+	class pool_allocator
+	{
+	public:
+		using value_type = T;
+
+		pool_allocator() = default;
+
+		template <typename U>
+		pool_allocator(const pool_allocator<U>&)
+		{}
+
+		auto allocate(const std::size_t count) -> T*
+		{
+			if (count != 1) return std::allocator<T> {}.allocate(count);
+
+			return object_pool<T>::global().allocate();
+		}
+
+		auto deallocate(T* const objects, const std::size_t count) -> void
+		{
+			if (count != 1) return std::allocator<T> {}.deallocate(objects, count);
+
+			object_pool<T>::global().deallocate(objects);
+		}
+
+		template <typename U>
+		auto operator==(const pool_allocator<U>&) const -> bool
+		{
+			return true;
+		}
+	};
+
+	// creates an object of type T along with its reference counts in a single slot of a global object pool
+	template <typename T, typename... Ts>
+	auto make_pooled(Ts&&... ts) -> std::shared_ptr<T>
+	{
+		return std::allocate_shared<T>(pool_allocator<T> {}, std::forward<Ts>(ts)...);
+	}
+}
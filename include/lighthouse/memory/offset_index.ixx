@@ -0,0 +1,158 @@
+module;
+
+export module memory_offset_index;
+
+import std;
+
+export namespace lh
+{
+	// flat open addressing hash index, mapping memory offsets to values of type T
+	// entries are stored inline in a single power of two sized array and probed linearly
+	// erasure shifts following entries back instead of leaving tombstones, keeping probe sequences short
+	// the maximum offset value is reserved to mark empty entries
+	template <typename T>
+	class offset_index
+	{
+	public:
+		using offset_t = std::size_t;
+
+		offset_index(const std::size_t initial_capacity = 0) : m_entries {}, m_size {}, m_shift {}
+		{
+			reserve(initial_capacity);
+		}
+
+		// returns false if the offset is already indexed
+		auto insert(const offset_t offset, const T& value) -> bool
+		{
+			if ((m_size + 1) * 4 > m_entries.size() * 3) rehash(std::max(m_entries.size() * 2, s_min_capacity));
+
+			for (auto i = home(offset);; i = next(i))
+			{
+				auto& entry = m_entries[i];
+
+				if (entry.m_offset == offset) return false;
+
+				if (entry.m_offset == s_empty)
+				{
+					entry = {offset, value};
+					m_size++;
+
+					return true;
+				}
+			}
+		}
+
+		// returns nullptr if the offset is not indexed
+		auto find(const offset_t offset) -> T*
+		{
+			const auto i = find_entry(offset);
+
+			return i == s_not_found ? nullptr : &m_entries[i].m_value;
+		}
+
+		auto contains(const offset_t offset) const -> bool { return find_entry(offset) != s_not_found; }
+
+		// removes the offset from the index, returning its value
+		auto extract(const offset_t offset) -> std::optional<T>
+		{
+			auto i = find_entry(offset);
+
+			if (i == s_not_found) return std::nullopt;
+
+			auto value = std::move(m_entries[i].m_value);
+			m_size--;
+
+			// shift back entries whose probe sequence passes through the vacated entry
+			for (auto j = next(i);; j = next(j))
+			{
+				auto& entry = m_entries[j];
+
+				if (entry.m_offset == s_empty) break;
+
+				const auto entry_home = home(entry.m_offset);
+
+				// entry home lies cyclically within (i, j], it stays in place
+				if ((i < j) ? (entry_home > i and entry_home <= j) : (entry_home > i or entry_home <= j)) continue;
+
+				m_entries[i] = std::move(entry);
+				i = j;
+			}
+
+			m_entries[i].m_offset = s_empty;
+
+			return value;
+		}
+
+		auto reserve(const std::size_t size) -> void
+		{
+			if (size == 0) return;
+
+			const auto required_capacity = std::max(std::bit_ceil(size + size / 3 + 1), s_min_capacity);
+
+			if (required_capacity > m_entries.size()) rehash(required_capacity);
+		}
+
+		auto clear() -> void
+		{
+			for (auto& entry : m_entries)
+				entry.m_offset = s_empty;
+
+			m_size = 0;
+		}
+
+		// visits every indexed offset and its value, in no particular order
+		template <typename F>
+		auto for_each(const F& function) const -> void
+		{
+			for (const auto& entry : m_entries)
+				if (entry.m_offset != s_empty) std::invoke(function, entry.m_offset, entry.m_value);
+		}
+
+		auto size() const -> const std::size_t { return m_size; }
+		auto empty() const -> bool { return m_size == 0; }
+
+	private:
+		struct entry
+		{
+			offset_t m_offset;
+			T m_value;
+		};
+
+		static inline constexpr auto s_empty = std::numeric_limits<offset_t>::max();
+		static inline constexpr auto s_not_found = std::numeric_limits<std::size_t>::max();
+		static inline constexpr auto s_min_capacity = std::size_t {16};
+
+		// fibonacci hashing spreads the aligned, low entropy offsets across the whole array
+		auto home(const offset_t offset) const -> std::size_t
+		{
+			return static_cast<std::size_t>((static_cast<std::uint64_t>(offset) * 0x9e3779b97f4a7c15ull) >> m_shift);
+		}
+
+		auto next(const std::size_t i) const -> std::size_t { return (i + 1) & (m_entries.size() - 1); }
+
+		auto find_entry(const offset_t offset) const -> std::size_t
+		{
+			if (m_size == 0 or offset == s_empty) return s_not_found;
+
+			for (auto i = home(offset);; i = next(i))
+			{
+				if (m_entries[i].m_offset == offset) return i;
+				if (m_entries[i].m_offset == s_empty) return s_not_found;
+			}
+		}
+
+		auto rehash(const std::size_t capacity) -> void
+		{
+			auto entries = std::exchange(m_entries, std::vector<entry>(capacity, entry {s_empty, T {}}));
+			m_shift = 64 - static_cast<std::size_t>(std::countr_zero(capacity));
+			m_size = 0;
+
+			for (auto& entry : entries)
+				if (entry.m_offset != s_empty) insert(entry.m_offset, entry.m_value);
+		}
+
+		std::vector<entry> m_entries;
+		std::size_t m_size;
+		std::size_t m_shift;
+	};
+}
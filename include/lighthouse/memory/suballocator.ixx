@@ -5,6 +5,8 @@ export module memory_suballocator;
 import data_type;
 import memory_block;
 import allocation_strategy;
+import memory_tlsf;
+import memory_allocation_statistics;
 import lighthouse_utility;
 
 import std;
@@ -29,6 +31,9 @@ export namespace lh
 		auto operator=(const memory_suballocator&) -> memory_suballocator& = delete;
 
 		[[nodiscard]] auto request_and_commit_suballocation(const std::size_t) -> void*;
+		// suballocation whose address is aligned to a power of two alignment
+		// padding in front of it remains available as a free memory block
+		[[nodiscard]] auto request_and_commit_suballocation(const std::size_t, const std::size_t) -> void*;
 		auto free_suballocation(const memory_block&) -> void;
 
 		auto pointer() const -> const non_owning_ptr<void>;
@@ -37,25 +42,54 @@ export namespace lh
 		auto used_memory_bytes() const -> const std::size_t;
 		auto free_memory_bytes() const -> const std::size_t;
 		auto free_memory_ratio() const -> const float01_t;
+		// bytes skipped over in order to satisfy alignment requirements, over the lifetime of the suballocator
+		auto total_alignment_padding_bytes() const -> const std::size_t;
+		// linear in the number of free memory blocks for the first fit strategy, constant otherwise
+		auto largest_free_block_bytes() const -> const std::size_t;
+		auto statistics() const -> const allocation_statistics;
 
 	private:
-		// function used for free memory block sorting, depends on allocation strategy
-		auto comparison_fn(const memory_block&, const memory_block&) const -> bool;
+		// ordering of the size index, depends on allocation strategy
+		// best fit orders by ascending size, worst fit by descending size, ties are broken by offset
+		struct memory_block_ordering
+		{
+			auto operator()(const memory_block&, const memory_block&) const -> bool;
+		};
+
+		static inline constexpr auto s_uses_size_index = A == allocation_strategy::best_fit or
+														 A == allocation_strategy::worst_fit;
+
+		using size_index_t = std::conditional_t<s_uses_size_index, std::set<memory_block, memory_block_ordering>, lh::empty>;
+
+		// iterator to a free memory block able to hold the requested size, according to allocation strategy
+		auto find_free_memory_block(const std::size_t, const std::size_t) -> std::vector<memory_block>::iterator;
+		// amount of bytes needed to align the start of a free memory block
+		auto alignment_padding(const memory_block&, const std::size_t) const -> const std::size_t;
+		auto offset_lower_bound(const std::size_t) -> std::vector<memory_block>::iterator;
 
-		auto erase_empty_free_memory_blocks() -> void;
-		auto merge_adjecent_free_memory_blocks() -> void;
-		auto sort_free_memory_blocks() -> void;
+		auto index_free_memory_block(const memory_block&) -> void;
+		auto unindex_free_memory_block(const memory_block&) -> void;
 
 		non_owning_ptr<void> m_ptr;
 		memory_block m_initial_memory_block;
 
 		// vector of free memory blocks, sorted by offset in ascending order
 		std::vector<memory_block> m_free_memory_blocks;
+		// free memory blocks ordered by size, only used by best and worst fit strategies
+		size_index_t m_free_memory_block_sizes;
+
+		// segregated free lists, only used by the two level segregated fit strategy
+		std::conditional_t<A == allocation_strategy::tlsf, two_level_segregated_fit, lh::empty> m_segregated_free_lists;
+
+		std::size_t m_free_memory_bytes;
+		std::size_t m_total_alignment_padding_bytes;
+		allocation_counters m_allocation_counters;
 	};
 
 	using first_fit_suballocator = memory_suballocator<allocation_strategy::first_fit>;
 	using best_fit_suballocator = memory_suballocator<allocation_strategy::best_fit>;
 	using worst_fit_suballocator = memory_suballocator<allocation_strategy::worst_fit>;
+	using tlsf_suballocator = memory_suballocator<allocation_strategy::tlsf>;
 
 	// ============================================================================
 	// template instantiations
@@ -67,42 +101,94 @@ export namespace lh
 												const initial_free_block_count_t initial_free_block_count)
 		: m_ptr {static_cast<std::byte*>(memory_ptr) + initial_memory.m_offset},
 		  m_initial_memory_block {initial_memory},
-		  m_free_memory_blocks {initial_memory}
+		  m_free_memory_blocks {},
+		  m_free_memory_block_sizes {},
+		  m_segregated_free_lists {[this, &initial_memory, initial_free_block_count] {
+			  if constexpr (A == allocation_strategy::tlsf)
+				  return two_level_segregated_fit {initial_memory.m_size, initial_free_block_count, address()};
+			  else
+				  return lh::empty {};
+		  }()},
+		  m_free_memory_bytes {initial_memory.m_size},
+		  m_total_alignment_padding_bytes {},
+		  m_allocation_counters {}
 	{
+		if constexpr (A == allocation_strategy::tlsf) return;
+
 		if (initial_free_block_count > 0) m_free_memory_blocks.reserve(initial_free_block_count);
+
+		// free memory blocks are relative to the suballocated range
+		const auto initial_free_memory_block = memory_block {0, initial_memory.m_size};
+
+		m_free_memory_blocks.push_back(initial_free_memory_block);
+		index_free_memory_block(initial_free_memory_block);
 	}
 
 	template <allocation_strategy A>
 	auto memory_suballocator<A>::request_and_commit_suballocation(const std::size_t size) -> void*
 	{
-		auto result = static_cast<void*>(nullptr);
-		auto iterator = m_free_memory_blocks.end();
+		return request_and_commit_suballocation(size, 1);
+	}
+
+	template <allocation_strategy A>
+	auto memory_suballocator<A>::request_and_commit_suballocation(const std::size_t size, const std::size_t alignment)
+		-> void*
+	{
+		if (not std::has_single_bit(alignment)) [[unlikely]]
+			return nullptr;
 
-		// iterate over free memory blocks and attempt to find a free memory block large enough to claim
-		// collect the resulting iterator, if found
-		for (auto it = m_free_memory_blocks.begin(); it != m_free_memory_blocks.end(); ++it)
-			if (size <= it->m_size)
+		if constexpr (A == allocation_strategy::tlsf)
+		{
+			const auto offset = m_segregated_free_lists.request_and_commit_suballocation(size, alignment);
+
+			if (offset == two_level_segregated_fit::invalid_offset) return nullptr;
+
+			m_allocation_counters.record_allocation(size, used_memory_bytes());
+
+			return static_cast<std::byte*>(m_ptr) + offset;
+		}
+		else
+		{
+			const auto iterator = find_free_memory_block(size, alignment);
+
+			if (iterator == m_free_memory_blocks.end()) [[unlikely]]
+				return nullptr;
+
+			const auto padding = alignment_padding(*iterator, alignment);
+			const auto claimed_offset = iterator->m_offset + padding;
+			const auto remainder = memory_block {claimed_offset + size, iterator->m_size - padding - size};
+
+			unindex_free_memory_block(*iterator);
+
+			// claim the free memory block after the padding, the padding itself remains free
+			// splitting a block in place preserves the offset ordering
+			if (padding > 0)
 			{
-				result = static_cast<std::byte*>(m_ptr) + it->m_offset;
-				iterator = it;
-				it->m_offset += size;
-				it->m_size -= size;
+				iterator->m_size = padding;
+				index_free_memory_block(*iterator);
 
-				break;
+				if (remainder.m_size > 0)
+				{
+					m_free_memory_blocks.insert(iterator + 1, remainder);
+					index_free_memory_block(remainder);
+				}
+
+				m_total_alignment_padding_bytes += padding;
 			}
-		
-		// if a valid iterator was found
-		if (iterator != m_free_memory_blocks.end()) [[likely]]
 			// if the underlying free memory block was taken in its entirety, erase it
-			if (iterator->m_size == 0)
+			else if (remainder.m_size == 0)
 				m_free_memory_blocks.erase(iterator);
 			else
-				// memory blocks are sorted according to their offset
-				std::ranges::sort(iterator, m_free_memory_blocks.end(), [this](const auto& x, const auto& y) {
-					return x.m_offset < y.m_offset; // return comparison_fn(x, y);
-				});
+			{
+				*iterator = remainder;
+				index_free_memory_block(remainder);
+			}
+
+			m_free_memory_bytes -= size;
+			m_allocation_counters.record_allocation(size, used_memory_bytes());
 
-		return result;
+			return static_cast<std::byte*>(m_ptr) + claimed_offset;
+		}
 	}
 
 	template <allocation_strategy A>
@@ -110,93 +196,61 @@ export namespace lh
 	{
 		// calculate the actual offset from the one provided by the pointer
 		const auto offset = memory_block.m_offset - reinterpret_cast<std::size_t>(m_ptr);
-		/*
-		auto found = std::upper_bound(m_free_memory_blocks.begin(),
-											m_free_memory_blocks.end(), offset,
-											[](std::size_t x, const auto& y) { return x < y.m_offset;
-											});
-											*/
-		/*
-		auto found = std::ranges::find_if(std::ranges::reverse_view {m_free_memory_blocks},
-										  [offset](const auto& x) {
-			return offset < x.m_offset;
-		}).base();*/
-
-		//auto found = m_free_memory_blocks.rbegin();
-
-		std::size_t i;
-
-		for (i = 0; i < m_free_memory_blocks.size() - 1; i++/*i = std::size_t {m_free_memory_blocks.size() - 1}; i >= 0; --i*/)
-		{
-			//if (offset < m_free_memory_blocks[i].m_offset)
-			{
-				if (offset + memory_block.m_size == m_free_memory_blocks[i].m_offset)
-				{
-					m_free_memory_blocks[i].m_offset -= memory_block.m_size;
-					m_free_memory_blocks[i].m_size += memory_block.m_size;
-					//std::cout << "merging left\n";
-					return;
-				}
-				else if (offset == m_free_memory_blocks[i].m_offset + m_free_memory_blocks[i].m_size)
-				{
-					m_free_memory_blocks[i].m_size += memory_block.m_size;
-					//std::cout << "merging right\n";
-					return;
-				}
-			}
-		}
 
-		const auto it = i == 0 ? m_free_memory_blocks.end() - 1 : m_free_memory_blocks.begin() + i;
-		m_free_memory_blocks.emplace(it, lh::memory_block {offset, memory_block.m_size});
-		//found = found.base();
-		/*
-		if (found != m_free_memory_blocks.rend())
+		// segregated free lists keep track of suballocated block sizes themselves
+		if constexpr (A == allocation_strategy::tlsf)
 		{
-			// merge left
-			if (offset + memory_block.m_size == found->m_offset)
-			{
-				found->m_offset -= memory_block.m_size;
-				found->m_size += memory_block.m_size;
-				std::cout << "merging left\n";
-				return;
-			}
+			if (m_segregated_free_lists.free_suballocation(offset) > 0) m_allocation_counters.record_free();
+
+			return;
 		}
 		else
 		{
-			if (found != m_free_memory_blocks.rbegin())
+			m_free_memory_bytes += memory_block.m_size;
+			m_allocation_counters.record_free();
+
+			// free memory blocks immediately preceding and succeeding the released one
+			const auto next = offset_lower_bound(offset);
+			const auto previous = next == m_free_memory_blocks.begin() ? m_free_memory_blocks.end() : next - 1;
+
+			const auto merge_left = previous != m_free_memory_blocks.end() and
+									previous->m_offset + previous->m_size == offset;
+			const auto merge_right = next != m_free_memory_blocks.end() and
+									 offset + memory_block.m_size == next->m_offset;
+
+			if (merge_left and merge_right)
 			{
-				found++;
-				// merge left
-				if (found->m_offset + found->m_size == offset)
-				{
-					found->m_size += memory_block.m_size;
-					std::cout << "merging right\n";
-					return;
-				}
-				found--;
+				unindex_free_memory_block(*previous);
+				unindex_free_memory_block(*next);
+
+				previous->m_size += memory_block.m_size + next->m_size;
+				index_free_memory_block(*previous);
+
+				m_free_memory_blocks.erase(next);
 			}
+			else if (merge_left)
+			{
+				unindex_free_memory_block(*previous);
 
-		}*/
-
-		// reclaim memory by inserting a free block into the vector
-		// sort it so its possible to merge adjecent free blocks
-		// erase empty ones
-		/*
-		m_free_memory_blocks.emplace(found != m_free_memory_blocks.rend()
-										 ? found.base()
-										 : m_free_memory_blocks.end() - 1,
-									 memory_suballocator<A>::memory_block {offset, memory_block.m_size});*/
-		/*
-		sort_free_memory_blocks();
-		merge_adjecent_free_memory_blocks();
-		erase_empty_free_memory_blocks();*/
-	}
+				previous->m_size += memory_block.m_size;
+				index_free_memory_block(*previous);
+			}
+			else if (merge_right)
+			{
+				unindex_free_memory_block(*next);
 
-	void fuck()
-	{
-		first_fit_suballocator ffs {nullptr, {0, 10}};
-		auto wtf = ffs.request_and_commit_suballocation(32);
-		ffs.free_suballocation({size_t(wtf), 32});
+				next->m_offset = offset;
+				next->m_size += memory_block.m_size;
+				index_free_memory_block(*next);
+			}
+			else
+			{
+				const auto reclaimed = lh::memory_block {offset, memory_block.m_size};
+
+				m_free_memory_blocks.insert(next, reclaimed);
+				index_free_memory_block(reclaimed);
+			}
+		}
 	}
 
 	template <allocation_strategy A>
@@ -220,12 +274,9 @@ export namespace lh
 	template <allocation_strategy A>
 	auto memory_suballocator<A>::free_memory_bytes() const -> const std::size_t
 	{
-		auto result = std::size_t {};
-
-		for (const auto& free_memory_block : m_free_memory_blocks)
-			result += free_memory_block.m_size;
+		if constexpr (A == allocation_strategy::tlsf) return m_segregated_free_lists.free_memory_bytes();
 
-		return result;
+		return m_free_memory_bytes;
 	}
 
 	template <allocation_strategy A>
@@ -238,61 +289,120 @@ export namespace lh
 	}
 
 	template <allocation_strategy A>
-	auto memory_suballocator<A>::comparison_fn(const memory_block& x, const memory_block& y) const -> bool
+	auto memory_suballocator<A>::total_alignment_padding_bytes() const -> const std::size_t
 	{
-		if constexpr (A == allocation_strategy::first_fit) return x.m_offset < y.m_offset;
+		if constexpr (A == allocation_strategy::tlsf) return m_segregated_free_lists.total_alignment_padding_bytes();
 
-		if constexpr (A == allocation_strategy::best_fit)
+		return m_total_alignment_padding_bytes;
+	}
+
+	template <allocation_strategy A>
+	auto memory_suballocator<A>::largest_free_block_bytes() const -> const std::size_t
+	{
+		if constexpr (A == allocation_strategy::tlsf)
+			return m_segregated_free_lists.largest_free_block_bytes();
+		else if constexpr (A == allocation_strategy::best_fit)
+			return m_free_memory_block_sizes.empty() ? 0 : m_free_memory_block_sizes.rbegin()->m_size;
+		else if constexpr (A == allocation_strategy::worst_fit)
+			return m_free_memory_block_sizes.empty() ? 0 : m_free_memory_block_sizes.begin()->m_size;
+		else
 		{
-			if (x.m_offset < y.m_offset) return true;
-			if (y.m_offset < x.m_offset) return false;
-			if (x.m_size < y.m_size) return true;
-			if (y.m_size < x.m_size) return false;
+			const auto largest = std::ranges::max_element(m_free_memory_blocks, {}, &memory_block::m_size);
+
+			return largest == m_free_memory_blocks.end() ? 0 : largest->m_size;
 		}
+	}
+
+	template <allocation_strategy A>
+	auto memory_suballocator<A>::statistics() const -> const allocation_statistics
+	{
+		auto statistics = allocation_statistics {.m_reserved_bytes = m_initial_memory_block.m_size,
+												 .m_used_bytes = used_memory_bytes(),
+												 .m_free_bytes = free_memory_bytes(),
+												 .m_largest_free_block_bytes = largest_free_block_bytes(),
+												 .m_total_alignment_padding_bytes = total_alignment_padding_bytes()};
+
+		if constexpr (A == allocation_strategy::tlsf)
+			statistics.m_free_block_count = m_segregated_free_lists.free_block_count();
+		else
+			statistics.m_free_block_count = m_free_memory_blocks.size();
+
+		m_allocation_counters.fill(statistics);
+
+		return statistics;
+	}
+
+	template <allocation_strategy A>
+	auto memory_suballocator<A>::memory_block_ordering::operator()(const memory_block& x, const memory_block& y) const
+		-> bool
+	{
+		if constexpr (A == allocation_strategy::best_fit)
+			if (x.m_size != y.m_size) return x.m_size < y.m_size;
 
 		if constexpr (A == allocation_strategy::worst_fit)
+			if (x.m_size != y.m_size) return x.m_size > y.m_size;
+
+		return x.m_offset < y.m_offset;
+	}
+
+	template <allocation_strategy A>
+	auto memory_suballocator<A>::find_free_memory_block(const std::size_t size, const std::size_t alignment)
+		-> std::vector<memory_block>::iterator
+	{
+		const auto fits = [this, size, alignment](const memory_block& free_memory_block) {
+			return size <= free_memory_block.m_size and
+				   alignment_padding(free_memory_block, alignment) <= free_memory_block.m_size - size;
+		};
+
+		if constexpr (A == allocation_strategy::best_fit)
 		{
-			if (x.m_offset < y.m_offset) return true;
-			if (y.m_offset < x.m_offset) return false;
-			if (x.m_size > y.m_size) return true;
-			if (y.m_size > x.m_size) return false;
+			// smallest free memory block large enough, lowest offset among equally sized ones
+			// blocks too small to hold the alignment padding are skipped
+			for (auto best = m_free_memory_block_sizes.lower_bound(memory_block {0, size});
+				 best != m_free_memory_block_sizes.end();
+				 ++best)
+				if (fits(*best)) return offset_lower_bound(best->m_offset);
+
+			return m_free_memory_blocks.end();
 		}
+		else if constexpr (A == allocation_strategy::worst_fit)
+		{
+			// largest free memory block, if it is large enough
+			for (auto worst = m_free_memory_block_sizes.begin();
+				 worst != m_free_memory_block_sizes.end() and worst->m_size >= size;
+				 ++worst)
+				if (fits(*worst)) return offset_lower_bound(worst->m_offset);
 
-		std::unreachable();
+			return m_free_memory_blocks.end();
+		}
+		else
+			return std::ranges::find_if(m_free_memory_blocks, fits);
 	}
 
 	template <allocation_strategy A>
-	auto memory_suballocator<A>::erase_empty_free_memory_blocks() -> void
+	auto memory_suballocator<A>::alignment_padding(const memory_block& memory_block, const std::size_t alignment) const
+		-> const std::size_t
 	{
-		const auto empty_memory_blocks = std::ranges::remove_if(m_free_memory_blocks, [](const auto& element) {
-			return element.m_size == 0;
-		});
+		const auto block_address = address() + memory_block.m_offset;
 
-		m_free_memory_blocks.erase(empty_memory_blocks.begin(), empty_memory_blocks.end());
+		return ((block_address + alignment - 1) & ~(alignment - 1)) - block_address;
 	}
 
 	template <allocation_strategy A>
-	auto memory_suballocator<A>::merge_adjecent_free_memory_blocks() -> void
+	auto memory_suballocator<A>::offset_lower_bound(const std::size_t offset) -> std::vector<memory_block>::iterator
 	{
-		for (auto i = std::size_t {1}; i < m_free_memory_blocks.size(); i++)
-		{
-			auto& previous = m_free_memory_blocks[i - 1];
-			auto& current = m_free_memory_blocks[i];
-
-			const auto memory_boundaries_align = previous.m_offset + previous.m_size == current.m_offset;
+		return std::ranges::lower_bound(m_free_memory_blocks, offset, {}, &memory_block::m_offset);
+	}
 
-			if (memory_boundaries_align and previous.m_size and current.m_size)
-			{
-				current.m_offset = previous.m_offset;
-				current.m_size += previous.m_size;
-				previous.m_size = 0;
-			}
-		}
+	template <allocation_strategy A>
+	auto memory_suballocator<A>::index_free_memory_block(const memory_block& memory_block) -> void
+	{
+		if constexpr (s_uses_size_index) m_free_memory_block_sizes.insert(memory_block);
 	}
 
 	template <allocation_strategy A>
-	auto memory_suballocator<A>::sort_free_memory_blocks() -> void
+	auto memory_suballocator<A>::unindex_free_memory_block(const memory_block& memory_block) -> void
 	{
-		std::ranges::sort(m_free_memory_blocks, [this](const auto& x, const auto& y) { return comparison_fn(x, y); });
+		if constexpr (s_uses_size_index) m_free_memory_block_sizes.erase(memory_block);
 	}
-}
\ No newline at end of file
+}
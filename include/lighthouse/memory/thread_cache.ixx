@@ -0,0 +1,387 @@
+module;
+
+export module memory_thread_cache;
+
+import allocation_strategy;
+import memory_block;
+import memory_heap;
+import memory_allocation_statistics;
+
+import std;
+
+export namespace lh
+{
+	// thread safe allocator, placing per thread caches in front of a shared memory pool
+	// small suballocations are served from per thread size class free lists without any synchronization
+	// free lists are refilled from and flushed to the shared memory pool in batches, under a single lock
+	// memory released on a thread other than the one it was claimed on is pushed onto a lock free stack of the
+	// owning thread cache, which drains it once its own free lists run dry
+	// large or over-aligned suballocations bypass the caches and go straight to the shared memory pool
+	template <lh::allocation_strategy A = lh::allocation_strategy::default_strategy>
+	class thread_caching_allocator
+	{
+	public:
+		struct create_info
+		{
+			// number of memory blocks moved between a thread cache and the shared memory pool at once
+			std::size_t m_batch_size = 32;
+			typename memory_pool<A>::create_info m_memory_pool_create_info = {};
+		};
+
+		template <typename T>
+		using allocator_t = heap_allocator<T, A, thread_caching_allocator>;
+
+		template <typename T>
+		using vector_t = std::vector<T, allocator_t<T>>;
+
+		thread_caching_allocator(const std::size_t size, const create_info& create_info = {})
+			: m_shared_state {std::make_shared<shared_state>(size, create_info)}
+		{}
+
+		// disallow copy construction
+		thread_caching_allocator(const thread_caching_allocator&) = delete;
+		auto operator=(const thread_caching_allocator&) -> thread_caching_allocator& = delete;
+
+		thread_caching_allocator(thread_caching_allocator&&) noexcept = default;
+		auto operator=(thread_caching_allocator&&) noexcept -> thread_caching_allocator& = default;
+
+		[[nodiscard]] auto request_and_commit_suballocation(const std::size_t size, const std::size_t alignment = 1)
+			-> void*
+		{
+			const auto size_class = size_class_index(size);
+
+			if (size_class == s_large_size_class or alignment > s_header_size)
+				return m_shared_state->request_large_suballocation(size, alignment);
+
+			auto& cache = local_thread_cache();
+			auto& free_list = cache.m_free_lists[size_class];
+
+			if (not free_list.m_head)
+			{
+				cache.drain_remote_suballocations();
+
+				if (not free_list.m_head) m_shared_state->refill(cache, size_class);
+				if (not free_list.m_head) return nullptr;
+			}
+
+			return free_list.pop();
+		}
+
+		// memory block size is required for suballocations bypassing the thread caches
+		auto free_suballocation(const memory_block& memory_block) -> void
+		{
+			const auto suballocation = reinterpret_cast<void*>(memory_block.m_offset);
+
+			if (not suballocation) return;
+
+			const auto& header = block_header::of(suballocation);
+
+			if (header.m_size_class == s_large_size_class)
+			{
+				m_shared_state->free_large_suballocation(suballocation, memory_block.m_size);
+				return;
+			}
+
+			// released on another thread, hand it back to the owner
+			if (header.m_owner != find_local_thread_cache())
+			{
+				header.m_owner->push_remote_suballocation(suballocation);
+				return;
+			}
+
+			auto& free_list = header.m_owner->m_free_lists[header.m_size_class];
+			free_list.push(suballocation);
+
+			if (free_list.m_count >= 2 * m_shared_state->m_create_info.m_batch_size)
+				m_shared_state->flush(*header.m_owner, header.m_size_class);
+		}
+
+		// memory claimed from the shared memory pool, memory held by thread caches included
+		auto used_memory_bytes() const -> const std::size_t
+		{
+			const auto lock = std::scoped_lock {m_shared_state->m_mutex};
+
+			return m_shared_state->m_memory_pool.used_memory_bytes();
+		}
+
+		// statistics of the shared memory pool, memory held by thread caches counts as used
+		auto statistics() const -> const allocation_statistics
+		{
+			const auto lock = std::scoped_lock {m_shared_state->m_mutex};
+
+			return m_shared_state->m_memory_pool.statistics();
+		}
+
+		template <typename T>
+		auto allocator() -> allocator_t<T>
+		{
+			return allocator_t<T> {*this};
+		}
+
+		template <typename T, typename... Ts>
+		auto vector(Ts&&... ts) -> vector_t<T>
+		{
+			return vector_t<T>(std::forward<Ts>(ts)..., allocator<T>());
+		}
+
+	private:
+		struct thread_cache;
+
+		// size classes are powers of two, starting at the header size
+		static inline constexpr auto s_header_size = alignof(std::max_align_t);
+		static inline constexpr auto s_min_size_class_log2 = static_cast<std::size_t>(std::bit_width(s_header_size) -
+																					   1);
+		static inline constexpr auto s_size_class_count = std::size_t {8};
+		static inline constexpr auto s_large_size_class = static_cast<std::uint32_t>(s_size_class_count);
+
+		static auto size_class_index(const std::size_t size) -> const std::uint32_t
+		{
+			const auto log2 = std::max(static_cast<std::size_t>(std::bit_width(std::max(size, std::size_t {1}) - 1)),
+									   s_min_size_class_log2);
+
+			return static_cast<std::uint32_t>(std::min(log2 - s_min_size_class_log2, s_size_class_count));
+		}
+
+		static auto size_class_size(const std::uint32_t size_class) -> const std::size_t
+		{
+			return std::size_t {1} << (size_class + s_min_size_class_log2);
+		}
+
+		// precedes every suballocation, the first bytes of free suballocations link them into free lists
+		struct block_header
+		{
+			static auto of(void* suballocation) -> block_header&
+			{
+				return *reinterpret_cast<block_header*>(static_cast<std::byte*>(suballocation) - s_header_size);
+			}
+
+			static auto next(void* suballocation) -> void*&
+			{
+				return *static_cast<void**>(suballocation);
+			}
+
+			thread_cache* m_owner;
+			std::uint32_t m_size_class;
+			// distance between the memory pool suballocation and the returned suballocation
+			std::uint32_t m_header_offset;
+		};
+		static_assert(sizeof(block_header) <= s_header_size);
+
+		struct free_list
+		{
+			auto push(void* suballocation) -> void
+			{
+				block_header::next(suballocation) = m_head;
+				m_head = suballocation;
+				++m_count;
+			}
+
+			auto pop() -> void*
+			{
+				const auto suballocation = m_head;
+				m_head = block_header::next(suballocation);
+				--m_count;
+
+				return suballocation;
+			}
+
+			void* m_head = nullptr;
+			std::size_t m_count = 0;
+		};
+
+		struct thread_cache
+		{
+			// lock free stack push, safe to call from any thread
+			auto push_remote_suballocation(void* suballocation) -> void
+			{
+				auto head = m_remote_suballocations.load(std::memory_order_relaxed);
+
+				do
+					block_header::next(suballocation) = head;
+				while (not m_remote_suballocations.compare_exchange_weak(head,
+																		  suballocation,
+																		  std::memory_order_release,
+																		  std::memory_order_relaxed));
+			}
+
+			// only called by the owning thread, the whole stack is claimed at once
+			auto drain_remote_suballocations() -> void
+			{
+				auto suballocation = m_remote_suballocations.exchange(nullptr, std::memory_order_acquire);
+
+				while (suballocation)
+				{
+					const auto next = block_header::next(suballocation);
+					m_free_lists[block_header::of(suballocation).m_size_class].push(suballocation);
+					suballocation = next;
+				}
+			}
+
+			std::array<free_list, s_size_class_count> m_free_lists {};
+			std::atomic<void*> m_remote_suballocations {nullptr};
+		};
+
+		// shared between the allocator and the threads it has caches on, allowing the allocator to be moved
+		// and threads to release their caches on exit, as long as the allocator is still alive
+		struct shared_state
+		{
+			shared_state(const std::size_t size, const create_info& create_info)
+				: m_create_info {create_info},
+				  m_mutex {},
+				  m_memory_pool {size, create_info.m_memory_pool_create_info},
+				  m_thread_caches {},
+				  m_orphaned_thread_caches {}
+			{
+				if (m_create_info.m_batch_size == 0) m_create_info.m_batch_size = 1;
+			}
+
+			// reuses caches of exited threads before creating new ones
+			auto acquire_thread_cache() -> thread_cache*
+			{
+				const auto lock = std::scoped_lock {m_mutex};
+
+				if (not m_orphaned_thread_caches.empty())
+				{
+					const auto cache = m_orphaned_thread_caches.back();
+					m_orphaned_thread_caches.pop_back();
+
+					return cache;
+				}
+
+				return m_thread_caches.emplace_back(std::make_unique<thread_cache>()).get();
+			}
+
+			// returns all cached memory to the memory pool, memory released remotely later on is kept until the cache
+			// gets adopted by another thread
+			auto release_thread_cache(thread_cache* cache) -> void
+			{
+				cache->drain_remote_suballocations();
+
+				const auto lock = std::scoped_lock {m_mutex};
+
+				for (auto size_class = std::uint32_t {}; size_class < s_size_class_count; size_class++)
+					while (cache->m_free_lists[size_class].m_head)
+						free_small_suballocation(cache->m_free_lists[size_class].pop(), size_class);
+
+				m_orphaned_thread_caches.push_back(cache);
+			}
+
+			auto refill(thread_cache& cache, const std::uint32_t size_class) -> void
+			{
+				auto& free_list = cache.m_free_lists[size_class];
+				const auto block_size = size_class_size(size_class) + s_header_size;
+				const auto lock = std::scoped_lock {m_mutex};
+
+				for (auto i = std::size_t {}; i < m_create_info.m_batch_size; i++)
+				{
+					const auto memory = static_cast<std::byte*>(
+						m_memory_pool.request_and_commit_suballocation(block_size, s_header_size));
+
+					if (not memory) return;
+
+					const auto suballocation = memory + s_header_size;
+					block_header::of(suballocation) = {&cache, size_class, static_cast<std::uint32_t>(s_header_size)};
+					free_list.push(suballocation);
+				}
+			}
+
+			auto flush(thread_cache& cache, const std::uint32_t size_class) -> void
+			{
+				auto& free_list = cache.m_free_lists[size_class];
+				const auto lock = std::scoped_lock {m_mutex};
+
+				for (auto i = std::size_t {}; i < m_create_info.m_batch_size and free_list.m_head; i++)
+					free_small_suballocation(free_list.pop(), size_class);
+			}
+
+			auto request_large_suballocation(const std::size_t size, const std::size_t alignment) -> void*
+			{
+				const auto header_offset = std::max(alignment, s_header_size);
+				const auto lock = std::scoped_lock {m_mutex};
+				const auto memory = static_cast<std::byte*>(
+					m_memory_pool.request_and_commit_suballocation(size + header_offset, header_offset));
+
+				if (not memory) return nullptr;
+
+				const auto suballocation = memory + header_offset;
+				block_header::of(suballocation) = {nullptr,
+												   s_large_size_class,
+												   static_cast<std::uint32_t>(header_offset)};
+
+				return suballocation;
+			}
+
+			auto free_large_suballocation(void* suballocation, const std::size_t size) -> void
+			{
+				const auto header_offset = block_header::of(suballocation).m_header_offset;
+				const auto lock = std::scoped_lock {m_mutex};
+
+				m_memory_pool.free_suballocation(
+					{reinterpret_cast<std::size_t>(suballocation) - header_offset, size + header_offset});
+			}
+
+			// requires the lock to be held
+			auto free_small_suballocation(void* suballocation, const std::uint32_t size_class) -> void
+			{
+				m_memory_pool.free_suballocation({reinterpret_cast<std::size_t>(suballocation) - s_header_size,
+												  size_class_size(size_class) + s_header_size});
+			}
+
+			create_info m_create_info;
+
+			std::mutex m_mutex;
+			memory_pool<A> m_memory_pool;
+			std::vector<std::unique_ptr<thread_cache>> m_thread_caches;
+			std::vector<thread_cache*> m_orphaned_thread_caches;
+		};
+
+		// thread caches of every allocator that the thread has claimed memory from
+		// caches are released on thread exit, provided their allocator still exists
+		struct thread_registry
+		{
+			struct registration
+			{
+				const shared_state* m_allocator;
+				std::weak_ptr<shared_state> m_shared_state;
+				thread_cache* m_thread_cache;
+			};
+
+			~thread_registry()
+			{
+				for (auto& registration : m_registrations)
+					if (const auto shared_state = registration.m_shared_state.lock())
+						shared_state->release_thread_cache(registration.m_thread_cache);
+			}
+
+			std::vector<registration> m_registrations;
+		};
+
+		static inline thread_local thread_registry s_thread_registry {};
+
+		auto find_local_thread_cache() const -> thread_cache*
+		{
+			for (const auto& registration : s_thread_registry.m_registrations)
+				if (registration.m_allocator == m_shared_state.get() and not registration.m_shared_state.expired())
+					return registration.m_thread_cache;
+
+			return nullptr;
+		}
+
+		auto local_thread_cache() -> thread_cache&
+		{
+			if (const auto cache = find_local_thread_cache()) [[likely]]
+				return *cache;
+
+			// registrations of destroyed allocators can be discarded
+			std::erase_if(s_thread_registry.m_registrations,
+						  [](const auto& registration) { return registration.m_shared_state.expired(); });
+
+			const auto cache = m_shared_state->acquire_thread_cache();
+			s_thread_registry.m_registrations.emplace_back(m_shared_state.get(), m_shared_state, cache);
+
+			return *cache;
+		}
+
+		std::shared_ptr<shared_state> m_shared_state;
+	};
+}
@@ -0,0 +1,109 @@
+module;
+
+export module memory_tlsf;
+
+import memory_offset_index;
+
+import std;
+
+export namespace lh
+{
+	// two level segregated fit free memory block index
+	// first level classes are powers of two, each one linearly subdivided into second level classes
+	// bitmaps keep track of non-empty classes, allowing constant time suballocation and release
+	// physically adjecent free memory blocks are coalesced immediately upon release
+	// block metadata is kept externally, the managed memory is never touched
+	class two_level_segregated_fit
+	{
+	public:
+		using offset_t = std::size_t;
+		using block_index_t = std::uint32_t;
+		using initial_block_count_t = std::uint32_t;
+
+		// returned from suballocations on error
+		static inline constexpr auto invalid_offset = std::numeric_limits<offset_t>::max();
+
+		// base address is only used to align suballocations, offsets are relative to it
+		two_level_segregated_fit(const std::size_t,
+								 const initial_block_count_t = 32,
+								 const std::uintptr_t base_address = 0);
+
+		// alignment needs to be a power of two
+		[[nodiscard]] auto request_and_commit_suballocation(const std::size_t, const std::size_t = 1) -> const offset_t;
+		// returns the size of the released memory block, 0 if the offset was not suballocated
+		auto free_suballocation(const offset_t) -> const std::size_t;
+
+		auto free_memory_bytes() const -> const std::size_t;
+		auto total_alignment_padding_bytes() const -> const std::size_t;
+		auto free_block_count() const -> const std::size_t;
+		// looks through the highest non-empty class only
+		auto largest_free_block_bytes() const -> const std::size_t;
+
+	private:
+		using first_level_bitmap_t = std::uint64_t;
+		using second_level_bitmap_t = std::uint32_t;
+
+		struct block
+		{
+			offset_t m_offset;
+			std::size_t m_size;
+
+			block_index_t m_previous_physical;
+			block_index_t m_next_physical;
+			block_index_t m_previous_free;
+			block_index_t m_next_free;
+
+			bool m_free;
+		};
+
+		struct mapping
+		{
+			std::size_t m_first_level;
+			std::size_t m_second_level;
+		};
+
+		// requested sizes are rounded up to multiples of granularity
+		static inline constexpr auto s_granularity_log2 = std::size_t {3};
+		static inline constexpr auto s_granularity = std::size_t {1} << s_granularity_log2;
+		static inline constexpr auto s_second_level_count_log2 = std::size_t {5};
+		static inline constexpr auto s_second_level_count = std::size_t {1} << s_second_level_count_log2;
+		// sizes below the small block size are all placed into the first first level class
+		static inline constexpr auto s_first_level_shift = s_second_level_count_log2 + s_granularity_log2;
+		static inline constexpr auto s_small_block_size = std::size_t {1} << s_first_level_shift;
+		static inline constexpr auto s_first_level_count = std::numeric_limits<std::size_t>::digits -
+														   s_first_level_shift + 1;
+		static inline constexpr auto s_null_block = std::numeric_limits<block_index_t>::max();
+
+		// class that a free memory block of given size belongs to
+		static auto mapping_insert(const std::size_t) -> const mapping;
+		// smallest class whose every free memory block is guaranteed to fit given size
+		static auto mapping_search(const std::size_t) -> const mapping;
+
+		auto find_suitable_block(const mapping&) const -> const block_index_t;
+		auto insert_free_block(const block_index_t) -> void;
+		auto remove_free_block(const block_index_t) -> void;
+
+		// split the front of a block off into a new free block
+		auto split_front(const block_index_t, const std::size_t) -> void;
+		// split the back of a block off into a new free block
+		auto split_back(const block_index_t, const std::size_t) -> void;
+
+		auto create_block(const offset_t, const std::size_t) -> const block_index_t;
+		auto recycle_block(const block_index_t) -> void;
+
+		// block metadata storage, released blocks are recycled
+		std::vector<block> m_blocks;
+		std::vector<block_index_t> m_recycled_blocks;
+		// suballocated blocks, keyed by their offsets
+		offset_index<block_index_t> m_used_blocks;
+
+		first_level_bitmap_t m_first_level_bitmap;
+		std::array<second_level_bitmap_t, s_first_level_count> m_second_level_bitmaps;
+		std::array<std::array<block_index_t, s_second_level_count>, s_first_level_count> m_free_lists;
+
+		std::uintptr_t m_base_address;
+		std::size_t m_free_memory_bytes;
+		std::size_t m_total_alignment_padding_bytes;
+		std::size_t m_free_block_count;
+	};
+}
@@ -10,6 +10,9 @@ export module virtual_allocator;
 export import vk_mem_alloc_hpp;
 #endif
 
+import memory_offset_index;
+import memory_allocation_statistics;
+
 import std;
 
 export namespace lh
@@ -32,22 +35,39 @@ export namespace lh
 			vma::VirtualAllocationCreateFlags m_allocation_flags {};
 		};
 
+		// embeds the virtual allocation, so that releasing it requires no lookup
+		struct handle
+		{
+			memory_offset_t m_offset = std::numeric_limits<memory_offset_t>::max();
+			vma::VirtualAllocation m_allocation {};
+		};
+
 		virtual_allocator(const std::size_t, create_info = {});
 
 		// disallow copy construction
 		virtual_allocator(const virtual_allocator&) = delete;
 		auto operator=(const virtual_allocator&) -> virtual_allocator& = delete;
 
-		virtual_allocator(virtual_allocator&&);
-		auto operator=(virtual_allocator&&) -> virtual_allocator&;
+		virtual_allocator(virtual_allocator&&) noexcept;
+		auto operator=(virtual_allocator&&) noexcept -> virtual_allocator&;
 
 		~virtual_allocator();
 
 		[[nodiscard]] auto request_and_commit_suballocation(const std::size_t, const allocation_info& = {}) -> const memory_offset_t;
 		auto free_suballocation(const memory_offset_t) -> void;
-		
+
+		// untracked suballocations, the handle needs to be kept by the caller
+		// handle offset is std::numeric_limits<memory_offset_t>::max() on error
+		[[nodiscard]] auto request_and_commit_handle(const std::size_t, const allocation_info& = {}) -> const handle;
+		auto free_suballocation(const handle&) -> void;
+
+		// memory layout is calculated by the virtual block, which is linear in the number of suballocations
+		auto statistics() const -> const allocation_statistics;
+
 	private:
 		vma::VirtualBlock m_virtual_block;
-		std::map<memory_offset_t, vma::VirtualAllocation> m_virtual_allocations;
+		// virtual allocations of offset based suballocations
+		offset_index<vma::VirtualAllocation> m_virtual_allocations;
+		allocation_counters m_allocation_counters;
 	};
 }
\ No newline at end of file
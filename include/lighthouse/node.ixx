@@ -9,6 +9,8 @@ module;
 export module node;
 
 import geometry;
+import job_system;
+import transform_hierarchy;
 
 #if not INTELLISENSE
 import glm;
@@ -30,6 +32,37 @@ export namespace lh
 			orphanage
 		};
 
+		// iterates children through their intrusive sibling links, yielding pointers to them
+		class child_iterator
+		{
+		public:
+			using iterator_concept = std::forward_iterator_tag;
+			using value_type = node*;
+			using difference_type = std::ptrdiff_t;
+
+			child_iterator() : m_child {nullptr} {}
+			explicit child_iterator(node* child) : m_child {child} {}
+
+			auto operator*() const -> node* { return m_child; }
+			auto operator++() -> child_iterator&
+			{
+				m_child = m_child->m_next_sibling;
+				return *this;
+			}
+			auto operator++(int) -> child_iterator
+			{
+				auto current = *this;
+				++*this;
+				return current;
+			}
+			auto operator==(const child_iterator&) const -> bool = default;
+
+		private:
+			node* m_child;
+		};
+
+		using children_t = std::ranges::subrange<child_iterator>;
+
 		node(node& parent = s_root_node,
 			 const geometry::transformation_t& = geometry::transformation_t {1.0f},
 			 destruction_strategy = destruction_strategy::collapse);
@@ -40,35 +73,66 @@ export namespace lh
 		~node();
 
 		static auto root_node() -> node&;
+		// storage of the transformations of every node, nodes only hold handles into it
+		static auto transforms() -> transform_hierarchy&;
 
 		auto parent(node&) -> void;
+		// detached nodes report the root node
 		auto parent() const -> node&;
 
+		// detached children are attached again with a new, identity transformation
 		auto add_child(node&) -> void;
+		// the removed child is attached to the root node
 		auto remove_child(node&) -> void;
-		auto children() const -> const std::vector<node*>&;
+		// children stay valid to iterate as long as they are not reparented or destroyed meanwhile
+		auto children() const -> children_t;
+		auto child_count() const -> const std::size_t;
 
 		auto is_ancestor_of(const node&) const -> bool;
 		auto is_descendent_of(const node&) const -> bool;
 		auto is_sibling_of(const node&) const -> bool;
 		auto descendent_count() const -> const std::size_t;
 
+		// reparents many subtrees at once, subtrees that would become their own descendents are skipped
+		static auto move_subtrees(std::span<node* const>, node& new_parent) -> void;
+		// tears the whole subtree down in a single sweep, including this node
+		// nodes of the subtree are left detached, destroying them afterwards takes constant time
+		// detached nodes have no transformation and can not adopt children, until they are added to a parent again
+		auto destroy_subtree() -> void;
+
 		auto operator==(const node&) const -> bool;
 		auto operator==(node&) -> bool;
 
+		// changing the local transformation invalidates the cached global transformations of the whole subtree
+		// detached nodes ignore changes and report identity transformations
 		auto local_transformation(const geometry::transformation_t&) -> void;
 		auto local_transformation() const -> const geometry::transformation_t&;
+		// cached, only recalculated along the path of invalidated ancestors
 		auto global_transformation() const -> const geometry::transformation_t;
+		// recalculates every invalidated global transformation within the subtree, in a single linear sweep
+		// meant to be called on the root node once per frame, before global transformations are queried
+		auto update_global_transformations() -> void;
+		// the root node distributes independent subtrees among jobs, other nodes update on the calling thread
+		auto update_global_transformations(job_system&) -> void;
 
 	private:
+		auto detached() const -> bool;
+		// the root node transformation is not part of global transformations, so its children are top level entries
+		auto transform_parent_of_children() const -> transform_hierarchy::handle;
 		// remove ourselves from our current parents children list
 		// this must be followed with acquisition of a new parent, unless called from the destructor
 		auto get_disowned() -> void;
+		// appends ourselves to the children list of the parent, without touching the transform hierarchy
+		auto link_to(node& parent) -> void;
+		// hands our children over according to the destruction strategy and leaves us detached
+		auto leave_hierarchy() -> void;
+		// takes over the place of a moved from node among its relatives
+		auto take_place_of(node&) -> void;
 
 		template <typename F>
 		auto traverse_down(const F& function, const node& node) const -> void
 		{
-			for (auto child : node.children())
+			for (auto child = node.m_first_child; child; child = child->m_next_sibling)
 			{
 				std::invoke(function, *child);
 
@@ -76,13 +140,20 @@ export namespace lh
 			}
 		}
 
+		// detached nodes have no parent
 		node* m_parent;
-		std::vector<node*> m_children;
+		// children form a doubly linked list through their sibling links, so that relinking takes constant time
+		node* m_first_child;
+		node* m_last_child;
+		node* m_previous_sibling;
+		node* m_next_sibling;
+		std::size_t m_child_count;
 
-		geometry::transformation_t m_transformation;
+		transform_hierarchy::handle m_transform;
 
 		destruction_strategy m_destruction_mode;
 
 		static node s_root_node;
+		static inline const auto s_identity = geometry::transformation_t {1.0f};
 	};
 }
@@ -14,18 +14,39 @@ export namespace lh
 	template <typename T>
 	class registry_entry;
 
+	// handle of an object registered in registry<T>
+	// handles stay valid while the object moves around, and become stale once it is destroyed
+	struct registry_handle
+	{
+		using index_t = std::uint32_t;
+		using generation_t = std::uint32_t;
+
+		auto operator==(const registry_handle&) const -> bool = default;
+
+		index_t m_index = std::numeric_limits<index_t>::max();
+		generation_t m_generation = 0;
+	};
+
 	// to be inherited by a type that is to act as a registry for type T
-	// keeps track of objects of type T
+	// keeps track of objects of type T in a slot map
+	// registered objects are kept densely packed for iteration, while slots map handles to their dense positions
+	// insertion, erasure and lookup take constant time, erasure moves the last entry into the vacated position
 	template <typename T, std::size_t N = initial_registry_capacity>
 	class registry
 	{
 	public:
 		using entries_t = std::vector<non_owning_ptr<T>>;
+		using handle_t = registry_handle;
 		friend registry_entry<T>;
 
-		registry() : m_entries {}
+		registry() : m_entries {}, m_slots_of_entries {}, m_slots {}, m_free_slot {s_null_index}
 		{
-			if constexpr (N > 0) m_entries.reserve(N);
+			if constexpr (N > 0)
+			{
+				m_entries.reserve(N);
+				m_slots_of_entries.reserve(N);
+				m_slots.reserve(N);
+			}
 
 			registry_entry<T>::s_registry = this;
 		}
@@ -33,10 +54,88 @@ export namespace lh
 		registry(const registry&) = delete;
 		auto operator=(const registry&) -> registry& = delete;
 
+		// registered objects, in no particular order
 		auto entries() const -> const entries_t& { return m_entries; }
 
+		// returns nullptr for stale handles
+		auto get(const handle_t& handle) const -> non_owning_ptr<T>
+		{
+			return valid(handle) ? m_entries[m_slots[handle.m_index].m_entry] : nullptr;
+		}
+
+		auto valid(const handle_t& handle) const -> bool
+		{
+			return handle.m_index < m_slots.size() and m_slots[handle.m_index].m_generation == handle.m_generation and
+				   m_slots[handle.m_index].m_entry != s_null_index;
+		}
+
+		auto size() const -> const std::size_t { return m_entries.size(); }
+
 	protected:
+		using index_t = handle_t::index_t;
+
+		static inline constexpr auto s_null_index = std::numeric_limits<index_t>::max();
+
+		struct slot
+		{
+			// dense position of the entry while the slot is in use, next free slot otherwise
+			index_t m_entry;
+			index_t m_next_free;
+			handle_t::generation_t m_generation;
+		};
+
+		auto insert(const non_owning_ptr<T> entry) -> handle_t
+		{
+			auto slot_index = m_free_slot;
+
+			if (slot_index == s_null_index)
+			{
+				slot_index = static_cast<index_t>(m_slots.size());
+				m_slots.emplace_back(s_null_index, s_null_index, handle_t::generation_t {});
+			}
+			else
+				m_free_slot = m_slots[slot_index].m_next_free;
+
+			auto& slot = m_slots[slot_index];
+			slot.m_entry = static_cast<index_t>(m_entries.size());
+
+			m_entries.push_back(entry);
+			m_slots_of_entries.push_back(slot_index);
+
+			return {slot_index, slot.m_generation};
+		}
+
+		auto erase(const handle_t& handle) -> void
+		{
+			if (not valid(handle)) return;
+
+			auto& slot = m_slots[handle.m_index];
+			const auto last_slot = m_slots_of_entries.back();
+
+			// move the last entry into the vacated position
+			m_entries[slot.m_entry] = m_entries.back();
+			m_slots_of_entries[slot.m_entry] = last_slot;
+			m_slots[last_slot].m_entry = slot.m_entry;
+
+			m_entries.pop_back();
+			m_slots_of_entries.pop_back();
+
+			slot.m_entry = s_null_index;
+			slot.m_next_free = m_free_slot;
+			slot.m_generation++;
+			m_free_slot = handle.m_index;
+		}
+
+		// points the handle to the new address of a moved object
+		auto relocate(const handle_t& handle, const non_owning_ptr<T> entry) -> void
+		{
+			if (valid(handle)) m_entries[m_slots[handle.m_index].m_entry] = entry;
+		}
+
 		entries_t m_entries {};
+		std::vector<index_t> m_slots_of_entries;
+		std::vector<slot> m_slots;
+		index_t m_free_slot;
 	};
 
 	// CRTP to be inherited by a type T whose objects are to be registered in registry<T>
@@ -48,27 +147,35 @@ export namespace lh
 	public:
 		friend registry<T>;
 
+		auto registry_handle() const -> const lh::registry_handle& { return m_registry_handle; }
+
 	protected:
-		registry_entry() { s_registry->m_entries.push_back(static_cast<non_owning_ptr<T>>(this)); }
-		~registry_entry() { std::erase(s_registry->m_entries, static_cast<non_owning_ptr<T>>(this)); }
+		registry_entry() : m_registry_handle {s_registry->insert(static_cast<non_owning_ptr<T>>(this))} {}
+		~registry_entry() { s_registry->erase(m_registry_handle); }
 
 		registry_entry(const registry_entry& other) = delete;
 		auto operator=(const registry_entry& other) -> registry_entry& = delete;
 
-		registry_entry(registry_entry&& other)
+		// the moved to object takes over the handle, the moved from object is no longer registered
+		registry_entry(registry_entry&& other) : m_registry_handle {std::exchange(other.m_registry_handle, {})}
 		{
-			const auto entry = std::ranges::find(s_registry->m_entries, static_cast<non_owning_ptr<T>>(this));
-			*entry = static_cast<non_owning_ptr<T>>(this);
+			s_registry->relocate(m_registry_handle, static_cast<non_owning_ptr<T>>(this));
 		}
 
 		auto operator=(registry_entry&& other) -> registry_entry&
 		{
-			const auto entry = std::ranges::find(s_registry->m_entries, static_cast<non_owning_ptr<T>>(this));
-			*entry = static_cast<non_owning_ptr<T>>(this);
+			if (this == &other) return *this;
+
+			s_registry->erase(m_registry_handle);
+
+			m_registry_handle = std::exchange(other.m_registry_handle, {});
+			s_registry->relocate(m_registry_handle, static_cast<non_owning_ptr<T>>(this));
 
 			return *this;
 		}
 
+		lh::registry_handle m_registry_handle;
+
 		static inline non_owning_ptr<registry<T>> s_registry {nullptr};
 	};
-}
\ No newline at end of file
+}
@@ -67,6 +67,7 @@ export namespace lh
 					   const geometry::position_t& = {},
 					   const geometry::normal_t = {},
 					   const geometry::scale_t = {});
+		~physical_light();
 
 		auto color(const colors::color&) -> void;
 		auto intensity(const intensity_t&) -> void;
@@ -77,13 +78,22 @@ export namespace lh
 		auto on_position_change() -> void override final;
 		auto on_rotation_change() -> void override final;
 		auto calculate_effective_radius() -> void;
+		// writes the light to the light stack right away, or in the next global light manager update for lights with
+		// deferred change notification
+		auto request_light_update() -> void;
 
 		virtual auto update_light_on_stack() -> void = 0;
 
 		template<typename T>
 		auto remove_light_from_stack() -> void;
 
+		static inline constexpr auto s_not_queued = std::numeric_limits<std::size_t>::max();
+
 		light::intensity_t m_effective_radius;
+		// position within the changed lights of the global light manager, if listed
+		std::size_t m_light_update_queue_index = s_not_queued;
+
+		friend class global_light_manager;
 	};
 
 	// specialized physical light, radiates light in all directions
@@ -220,6 +230,9 @@ export namespace lh
 
 		auto light_device_addresses() const -> const std::array<vk::DeviceAddress, 4>&;
 
+		// writes every light changed since the last update to the light stack, once
+		auto update() -> void;
+
 	private:
 		create_info m_create_info;
 
@@ -227,6 +240,8 @@ export namespace lh
 		std::vector<spot_light*> m_spot_lights;
 		std::vector<directional_light*> m_directional_lights;
 		std::vector<ambient_light*> m_ambient_lights;
+		// lights destroyed while queued leave null entries behind, so that leaving the queue takes constant time
+		std::vector<physical_light*> m_changed_lights;
 
 		vulkan::descriptor_resource_buffer m_light_resource_buffer;
 		std::array<vk::DeviceAddress, 4> m_light_device_addresses;
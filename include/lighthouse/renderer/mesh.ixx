@@ -9,6 +9,7 @@ export module mesh;
 import node;
 import geometry;
 import buffer;
+import memory_mapped_span;
 import lighthouse_utility;
 import object_index;
 import registry;
@@ -18,12 +19,27 @@ import std;
 
 export namespace lh
 {
+	// instances of a mesh are kept densely packed, removal moves the last instance into the vacated position
+	// instance handles stay valid while instances move around, and become stale once the instance is removed
+	// instances are mirrored into a span of a mapped suballocated buffer, only modified instances are copied over
 	class mesh : public object_index<mesh>, public registry_entry<mesh>
 	{
 	public:
 		using buffer_type_t = vulkan::buffer;
+		using instance_buffer_t = vulkan::suballocated_buffer<vulkan::mapped_buffer>;
 		using instance_t = geometry::transformation_t;
 
+		struct instance_handle
+		{
+			using index_t = std::uint32_t;
+			using generation_t = std::uint32_t;
+
+			auto operator==(const instance_handle&) const -> bool = default;
+
+			index_t m_index = std::numeric_limits<index_t>::max();
+			generation_t m_generation = 0;
+		};
+
 		struct create_info
 		{};
 
@@ -35,6 +51,7 @@ export namespace lh
 		mesh(mesh&&) noexcept;
 		mesh(const mesh&&) noexcept;
 		mesh& operator=(mesh&&) noexcept;
+		~mesh();
 
 		auto node() const -> const node&;
 		auto vertex_subdata() const -> const vulkan::buffer_subdata<buffer_type_t>::subdata&;
@@ -43,9 +60,21 @@ export namespace lh
 		auto vertex_count() const -> const std::size_t;
 		auto index_count() const -> const std::size_t;
 		auto instance_count() const -> const std::size_t;
-		auto add_instance(const instance_t&) -> void;
-		auto add_instances(const std::vector<instance_t>&) -> void;
-		auto remove_instance(const instance_t&) -> void;
+		auto add_instance(const instance_t&) -> instance_handle;
+		auto add_instances(std::span<const instance_t>) -> std::vector<instance_handle>;
+		auto remove_instance(const instance_handle&) -> void;
+		auto valid(const instance_handle&) const -> bool;
+		// stale handles are ignored when setting, and read as the identity
+		auto instance(const instance_handle&, const instance_t&) -> void;
+		auto instance(const instance_handle&) const -> const instance_t&;
+		// live instances in mirrored order, the same order they are drawn in
+		auto instances() const -> std::span<const instance_t>;
+
+		// copies instances modified since the last call into the buffer, every mesh sticks to a single buffer
+		// the span grows geometrically when the instances outgrow it, in which case all instances are copied
+		auto mirror_instances(instance_buffer_t&) -> void;
+		// device address of the mirrored instances, changes whenever the mirror grows or is moved by defragmentation
+		auto instance_address() const -> const vk::DeviceAddress;
 
 		auto bind(const vk::raii::CommandBuffer&) const -> void;
 
@@ -55,6 +84,35 @@ export namespace lh
 		geometry::aabb m_bounding_box;
 		std::size_t m_vertex_count;
 		std::size_t m_index_count;
+
+		static inline constexpr auto s_null_instance_index = std::numeric_limits<instance_handle::index_t>::max();
+		static inline constexpr auto s_min_mirrored_instances = std::size_t {16};
+		static inline const auto s_identity_instance = instance_t {1.0f};
+
+		struct instance_slot
+		{
+			// dense position of the instance while the slot is in use, next free slot otherwise
+			instance_handle::index_t m_instance;
+			instance_handle::generation_t m_generation;
+		};
+
+		// keeps the mirror and its address in sync when defragmentation moves the mirror
+		auto relocation_callback() -> instance_buffer_t::relocation_callback_t;
+		auto mark_dirty(const instance_handle::index_t) -> void;
+		auto release_instance_mirror() -> void;
+
 		std::vector<instance_t> m_instances;
+		std::vector<instance_handle::index_t> m_slots_of_instances;
+		std::vector<instance_slot> m_instance_slots;
+		std::vector<instance_handle::index_t> m_free_instance_slots;
+
+		// dense positions modified since the last mirroring, may contain duplicates and removed positions
+		std::vector<instance_handle::index_t> m_dirty_instances;
+		std::vector<bool> m_dirty_flags;
+
+		non_owning_ptr<instance_buffer_t> m_instance_buffer;
+		memory_mapped_span<instance_t> m_instance_mirror;
+		vk::DeviceAddress m_instance_address;
+		bool m_mirror_requires_full_copy;
 	};
 }
\ No newline at end of file
@@ -9,6 +9,7 @@ import memory_allocator;
 import scene_data;
 import geometry;
 import mesh;
+import bvh;
 import registry;
 
 import std;
@@ -44,9 +45,18 @@ export namespace lh
 		auto sphere() const -> const lh::mesh&;
 		auto cylinder() const -> const lh::mesh&;
 		auto cone() const -> const lh::mesh&;
+		// mutable access, for managing the instances of default meshes
+		auto plane() -> lh::mesh&;
+		auto cube() -> lh::mesh&;
+		auto sphere() -> lh::mesh&;
+		auto cylinder() -> lh::mesh&;
+		auto cone() -> lh::mesh&;
+		// mesh space hierarchy over the triangles of a default mesh, for ray queries on the cpu
+		auto bvh_of(const default_meshes) const -> const geometry::bvh&;
 
 	private:
 		std::array<mesh, std::to_underlying(default_meshes::default_mesh_count)> m_default_meshes;
+		std::vector<geometry::bvh> m_default_mesh_bvhs;
 		std::vector<vulkan::buffer> m_mesh_buffers;
 	};
 }
\ No newline at end of file
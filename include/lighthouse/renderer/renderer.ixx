@@ -13,6 +13,7 @@ import logical_device;
 import surface;
 import queue_families;
 import memory_allocator;
+import memory_frame_arena;
 import command_control;
 import queue;
 import pipeline_layout;
@@ -27,6 +28,8 @@ import mesh_registry;
 import skybox;
 import user_interface;
 import push_constant;
+import scene;
+import lighthouse_utility;
 
 #if not INTELLISENSE
 import glm;
@@ -45,6 +48,10 @@ export namespace lh
 			version m_vulkan_version;
 
 			bool m_using_validation = true;
+			// initial size of each per frame arena, arenas grow to the high-water mark if exceeded
+			std::size_t m_frame_arena_size = 1024 * 1024;
+			// instances the buffer mirroring every mesh can hold, the visible instances of each frame come on top
+			std::size_t m_max_instances = 1000;
 		};
 
 		renderer(const window&, const create_info&);
@@ -53,6 +60,9 @@ export namespace lh
 
 		auto render() -> void;
 
+		// memory claimed from the frame arena is valid until the frame comes around again
+		auto frame_arena() -> lh::frame_arena&;
+
 	private:
 		class implementation_inspector
 		{
@@ -68,6 +78,7 @@ export namespace lh
 		create_info m_create_info;
 
 		const lh::window& m_window;
+		buffered_frame_arena<> m_frame_arena;
 
 		vulkan::instance m_instance;
 		vulkan::physical_device m_physical_device;
@@ -87,22 +98,18 @@ export namespace lh
 		global_light_manager m_global_light_manager;
 		vulkan::descriptor_buffer m_global_descriptor_buffer;
 		vulkan::push_constant m_push_constant;
+		// meshes release their instance mirrors on destruction, so the buffer needs to outlive them
+		vulkan::suballocated_buffer<vulkan::mapped_buffer> m_instance_buffer;
+		// indices of the instances visible in each frame in flight, compacted for drawing, grown as needed
+		std::vector<memory_mapped_span<std::uint32_t>> m_visible_instances;
 		mesh_registry m_mesh_registry;
 		//vulkan::suballocated_buffer<vulkan::mapped_buffer> m_mapped_range;
-		vulkan::suballocated_buffer<vulkan::mapped_buffer> m_instance_buffer;
 
 		vulkan::pipeline m_test_pipeline;
 		//scene_data m_scene_loader;
-		lh::camera<camera_type::perspective> m_camera;
 		material m_material;
-		point_light m_point_light;
-		point_light m_point_light2;
-		spot_light m_spot_light;
-		spot_light m_spot_light2;
-		directional_light m_dir_light;
-		directional_light m_dir_light2;
-		ambient_light m_amb_light;
-		ambient_light m_amb_light2;
+		scene m_scene;
+		non_owning_ptr<point_light> m_animated_light;
 		skybox m_skybox;
 		vulkan::suballocated_buffer<vulkan::mapped_buffer> m_test;
 	};
@@ -9,6 +9,8 @@ export module user_interface;
 
 import input;
 import dear_imgui;
+import lighthouse_string;
+import memory_allocation_statistics;
 
 #if not INTELLISENSE
 import vk_mem_alloc_hpp;
@@ -51,6 +53,8 @@ export namespace lh
 		auto draw_crosshair() -> void;
 		auto draw_gpu_statistics(const vma::TotalStatistics&) -> void;
 		auto draw_gpu_budgets(const std::vector<vma::Budget>&) -> void;
+		// suballocator statistics, allocation and release rates are measured between calls with the same name
+		auto draw_allocation_statistics(const string::string_t&, const allocation_statistics&) -> void;
 		auto register_key_event(const input::key_binding::key_input&, const action&) -> void;
 
 	private:
@@ -59,5 +63,16 @@ export namespace lh
 		lh::dear_imgui m_dear_imgui;
 
 		std::vector<action> m_actions;
+
+		struct allocation_rate_sample
+		{
+			double m_time;
+			std::size_t m_total_allocation_count;
+			std::size_t m_total_free_count;
+			float m_allocation_rate;
+			float m_free_rate;
+		};
+
+		std::unordered_map<string::string_t, allocation_rate_sample> m_allocation_rate_samples;
 	};
 }
\ No newline at end of file
@@ -15,6 +15,8 @@ import logical_device;
 import memory_block;
 import memory_allocator;
 import virtual_allocator;
+import memory_offset_index;
+import memory_allocation_statistics;
 import output;
 //import queue;
 
@@ -157,12 +159,26 @@ export namespace lh
 		class suballocated_buffer : public T
 		{
 		public:
+			// invoked once a defragmentation pass has moved a movable suballocation, with its previous and new memory
+			// blocks, offsets are relative to the start of the buffer
+			using relocation_callback_t = std::function<void(const memory_block&, const memory_block&)>;
+
+			struct defragmentation_info
+			{
+				// bound the amount of work recorded by a single pass
+				std::size_t m_max_bytes_per_pass = 4 * 1024 * 1024;
+				std::size_t m_max_moves_per_pass = 64;
+			};
+
 			suballocated_buffer(const logical_device& logical_device,
 									   const memory_allocator& memory_allocator,
 									   const vk::DeviceSize size,
 									   const T::create_info& create_info = T::s_create_info)
 				: T {logical_device, memory_allocator, size, create_info},
-				  m_virtual_allocator {size}
+				  m_virtual_allocator {size},
+				  m_movable_suballocations {},
+				  m_pending_moves {},
+				  m_pending_copies {}
 			{}
 
 			suballocated_buffer(const suballocated_buffer&) = delete;
@@ -175,30 +191,64 @@ export namespace lh
 				const auto memory_offset = m_virtual_allocator.request_and_commit_suballocation(element_count * sizeof (Y));
 
 				if (memory_offset == std::numeric_limits<virtual_allocator::memory_offset_t>::max())
-					output::error() << lh::string::string_t {"could not allocate: " + element_count * sizeof (Y)}.append(
-						" bytes from buffer at address: " + T::address());
+				{
+					output::error() << "could not allocate: " << element_count * sizeof(Y)
+									<< " bytes from buffer at address: " << T::address();
+					return memory_mapped_span<Y> {nullptr, 0};
+				}
 
 				const auto memory_address = static_cast<std::byte*>(T::m_mapped_data_pointer) + memory_offset;
 
 				return memory_mapped_span<Y> {reinterpret_cast<Y*>(memory_address), element_count};
 			}
 
+			// span which defragmentation passes are allowed to move, the relocation callback is responsible for
+			// replacing every copy of the span and of its device address
+			template <typename Y>
+				requires std::is_same_v<T, mapped_buffer>
+			[[nodiscard]] auto request_and_commit_movable_span(const std::size_t element_count,
+															   const relocation_callback_t& relocation_callback)
+				-> memory_mapped_span<Y>
+			{
+				const auto span = request_and_commit_span<Y>(element_count);
+
+				if (span.data())
+					m_movable_suballocations.insert(span_offset(span), {span.size_bytes(), relocation_callback});
+
+				return span;
+			}
+
+			// replaces the relocation callback of a movable span, such as when the owner of the span has moved
+			template <typename Y>
+				requires std::is_same_v<T, mapped_buffer>
+			auto relocation_callback(const memory_mapped_span<Y>& span, const relocation_callback_t& callback) -> void
+			{
+				if (auto movable_suballocation = m_movable_suballocations.find(span_offset(span)))
+					movable_suballocation->m_relocation_callback = callback;
+			}
+
 			template <typename Y>
 				requires std::is_same_v<T, mapped_buffer>
 			auto free_span(const memory_mapped_span<Y>& span) -> void
 			{
-				const auto span_ptr = reinterpret_cast<std::uintptr_t>(span.data());
-				const auto mapped_ptr = reinterpret_cast<std::uintptr_t>(T::mapped_data_pointer());
+				release_suballocation(span_offset(span));
+			}
+
+			// span covering a memory block, as passed to relocation callbacks
+			template <typename Y>
+				requires std::is_same_v<T, mapped_buffer>
+			auto span(const memory_block& memory_block) const -> memory_mapped_span<Y>
+			{
+				const auto memory_address = static_cast<std::byte*>(T::m_mapped_data_pointer) + memory_block.m_offset;
 
-				m_virtual_allocator.free_suballocation(span_ptr - mapped_ptr);
+				return memory_mapped_span<Y> {reinterpret_cast<Y*>(memory_address), memory_block.m_size / sizeof(Y)};
 			}
 
 			template <typename Y>
 				requires std::is_same_v<T, mapped_buffer>
 			auto span_device_address(const memory_mapped_span<Y>& span) -> const vk::DeviceAddress
 			{
-				return mapped_buffer::address() + reinterpret_cast<std::uintptr_t>(T::m_mapped_data_pointer) -
-					   reinterpret_cast<std::uintptr_t>(span.data());
+				return T::address() + span_offset(span);
 			}
 
 			template <typename Y>
@@ -208,28 +258,179 @@ export namespace lh
 				const auto memory_offset = m_virtual_allocator.request_and_commit_suballocation(range_size);
 
 				if (memory_offset == std::numeric_limits<virtual_allocator::memory_offset_t>::max())
-					output::error() << lh::string::string_t {"could not allocate: " + range_size}.append(
-						" bytes from buffer at address: " + T::address());
+					output::error() << "could not allocate: " << range_size
+									<< " bytes from buffer at address: " << T::address();
 
 				return {memory_offset, range_size};
 			}
 
+			// range which defragmentation passes are allowed to move
 			template <typename Y>
 				requires std::is_same_v<T, buffer>
-			auto free_range(const lh::memory_block& memory_block) -> void
+			auto request_and_commit_movable_range(std::size_t range_size, const relocation_callback_t& relocation_callback)
+				-> const lh::memory_block
 			{
-				m_virtual_allocator.free_suballocation(memory_block.m_offset);
+				const auto memory_block = request_and_commit_range<Y>(range_size);
+
+				if (memory_block.m_offset != std::numeric_limits<virtual_allocator::memory_offset_t>::max())
+					m_movable_suballocations.insert(memory_block.m_offset, {range_size, relocation_callback});
+
+				return memory_block;
 			}
 
 			template <typename Y>
 				requires std::is_same_v<T, buffer>
+			auto free_range(const lh::memory_block& memory_block) -> void
+			{
+				release_suballocation(memory_block.m_offset);
+			}
+
 			auto range_address(const memory_block& memory_block) -> const vk::DeviceAddress
 			{
-				return mapped_buffer::address() + memory_block.m_offset;
+				return T::address() + memory_block.m_offset;
+			}
+
+			// moves movable suballocations from the end of the buffer into the lowest free offsets
+			// records the copies into the command buffer and returns the number of recorded moves
+			// the buffer requires transfer source and destination usage
+			// contents of moving suballocations must not change until the pass is finished
+			auto record_defragmentation_pass(const vk::raii::CommandBuffer& command_buffer,
+											 const defragmentation_info& defragmentation_info = {}) -> std::size_t
+			{
+				if (not m_pending_moves.empty())
+				{
+					output::warning() << "defragmentation pass of buffer at address: " << T::address()
+									  << " needs to be finished before recording another one";
+					return 0;
+				}
+
+				const auto required_usage = vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst;
+
+				if ((T::create_information().m_usage & required_usage) != required_usage)
+				{
+					output::warning() << "buffer at address: " << T::address()
+									  << " requires transfer usage in order to be defragmented";
+					return 0;
+				}
+
+				// suballocations at the highest offsets are moved first
+				auto candidates = std::vector<memory_block> {};
+				candidates.reserve(m_movable_suballocations.size());
+
+				m_movable_suballocations.for_each([&candidates](const auto offset, const auto& movable_suballocation) {
+					candidates.emplace_back(offset, movable_suballocation.m_size);
+				});
+				std::ranges::sort(candidates, std::ranges::greater {}, &memory_block::m_offset);
+
+				const auto allocation_info = virtual_allocator::allocation_info {
+					.m_allocation_flags = vma::VirtualAllocationCreateFlagBits::eStrategyMinOffset};
+				auto moved_bytes = std::size_t {};
+
+				for (const auto& candidate : candidates)
+				{
+					if (m_pending_moves.size() >= defragmentation_info.m_max_moves_per_pass) break;
+					if (moved_bytes + candidate.m_size > defragmentation_info.m_max_bytes_per_pass) continue;
+
+					const auto destination_offset = m_virtual_allocator.request_and_commit_suballocation(candidate.m_size,
+																										 allocation_info);
+
+					if (destination_offset == std::numeric_limits<virtual_allocator::memory_offset_t>::max()) continue;
+
+					// no lower offset could be found, leave the suballocation where it is
+					if (destination_offset > candidate.m_offset)
+					{
+						m_virtual_allocator.free_suballocation(destination_offset);
+						continue;
+					}
+
+					m_pending_moves.emplace_back(candidate, memory_block {destination_offset, candidate.m_size}, false);
+					m_pending_copies.emplace_back(candidate.m_offset, destination_offset, candidate.m_size);
+					moved_bytes += candidate.m_size;
+				}
+
+				// source and destination regions never overlap, both are suballocated at the same time
+				if (not m_pending_copies.empty())
+				{
+					const auto& buffer = *static_cast<const T&>(*this);
+					command_buffer.copyBuffer2(vk::CopyBufferInfo2 {buffer, buffer, m_pending_copies});
+				}
+
+				return m_pending_moves.size();
+			}
+
+			// needs to be called once the recorded copies have completed
+			// releases the previous memory blocks and invokes relocation callbacks
+			auto finish_defragmentation_pass() -> void
+			{
+				for (const auto& [source, destination, cancelled] : m_pending_moves)
+				{
+					if (cancelled) continue;
+
+					auto movable_suballocation = m_movable_suballocations.extract(source.m_offset);
+					m_virtual_allocator.free_suballocation(source.m_offset);
+
+					if (not movable_suballocation) continue;
+
+					m_movable_suballocations.insert(destination.m_offset, *movable_suballocation);
+
+					if (movable_suballocation->m_relocation_callback)
+						std::invoke(movable_suballocation->m_relocation_callback, source, destination);
+				}
+
+				m_pending_moves.clear();
+				m_pending_copies.clear();
+			}
+
+			auto statistics() const -> const allocation_statistics
+			{
+				return m_virtual_allocator.statistics();
 			}
 
 		private:
+			struct movable_suballocation
+			{
+				std::size_t m_size;
+				relocation_callback_t m_relocation_callback;
+			};
+
+			struct pending_move
+			{
+				memory_block m_source;
+				memory_block m_destination;
+				// released while its pass was still pending
+				bool m_cancelled;
+			};
+
+			template <typename Y>
+			auto span_offset(const memory_mapped_span<Y>& span) const -> const std::size_t
+			{
+				return reinterpret_cast<std::uintptr_t>(span.data()) -
+					   reinterpret_cast<std::uintptr_t>(T::mapped_data_pointer());
+			}
+
+			auto release_suballocation(const std::size_t offset) -> void
+			{
+				// a suballocation that is being moved releases its destination as well
+				const auto pending_move = std::ranges::find_if(m_pending_moves, [offset](const auto& pending_move) {
+					return pending_move.m_source.m_offset == offset and not pending_move.m_cancelled;
+				});
+
+				if (pending_move != m_pending_moves.end())
+				{
+					pending_move->m_cancelled = true;
+					m_virtual_allocator.free_suballocation(pending_move->m_destination.m_offset);
+				}
+
+				std::ignore = m_movable_suballocations.extract(offset);
+				m_virtual_allocator.free_suballocation(offset);
+			}
+
 			lh::virtual_allocator m_virtual_allocator;
+
+			// suballocations which defragmentation passes are allowed to move, keyed by their offsets
+			offset_index<movable_suballocation> m_movable_suballocations;
+			std::vector<pending_move> m_pending_moves;
+			std::vector<vk::BufferCopy2> m_pending_copies;
 		};
 
 		// =========================================================================
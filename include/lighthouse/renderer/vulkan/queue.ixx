@@ -138,6 +138,27 @@ export namespace lh
 				m_suballocated_buffer.free_span(span);
 			}
 
+			// runs a single bounded defragmentation pass over the buffer and waits for its copies to complete
+			// returns the number of moved suballocations
+			template <typename T>
+			auto defragment_and_wait(suballocated_buffer<T>& buffer,
+									 const typename suballocated_buffer<T>::defragmentation_info& defragmentation_info = {})
+				-> std::size_t
+			{
+				m_command_control.reset();
+				const auto& command_buffer = m_command_control.front();
+
+				command_buffer.begin(m_command_control.usage_flags());
+				const auto move_count = buffer.record_defragmentation_pass(command_buffer, defragmentation_info);
+				command_buffer.end();
+
+				if (move_count > 0) submit_and_wait();
+
+				buffer.finish_defragmentation_pass();
+
+				return move_count;
+			}
+
 		private:
 			auto clear() -> void override final;
 
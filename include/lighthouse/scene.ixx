@@ -2,23 +2,157 @@ module;
 
 export module scene;
 
+import node;
 import mesh;
-import buffer;
-import memory_allocator;
-import scene_data;
+import light;
+import camera;
+import geometry;
+import bounding_volume;
+import frustum;
+import memory_object_pool;
+import lighthouse_utility;
+
+#if not INTELLISENSE
+import glm;
+#endif
 
 import std;
 
 export namespace lh
 {
+	// owns the nodes, meshes, mesh instances, lights and cameras that make up a scene
+	// objects refer to their mesh without owning it, as meshes are shared between many objects and scenes may also use
+	// meshes they do not own, such as the default meshes of the mesh registry, which need to outlive the scene
+	// objects are scene owned nodes with an optional mesh, their world space bounds are kept in a loose octree
+	// changing transformations or parents through the scene only marks the affected objects as moved,
+	// update() then refreshes the bounds, octree entries and mesh instances of moved objects alone
 	class scene
 	{
+	private:
+		struct object
+		{
+			object(lh::node& parent, const geometry::transformation_t&, const non_owning_ptr<lh::mesh>);
+			~object();
+
+			lh::node m_node;
+			non_owning_ptr<lh::mesh> m_mesh;
+			lh::mesh::instance_handle m_instance;
+
+			// world space bounds as of the last update, along with their entry in the spatial index
+			geometry::aabb m_bounds;
+			geometry::octree_handle m_spatial_entry;
+			bool m_moved;
+		};
+
 	public:
+		using handle = object_pool<object>::handle;
+		using camera_t = camera<camera_type::perspective>;
+
+		struct create_info
+		{
+			// edge length of the largest nodes of the spatial index
+			geometry::scalar_t m_spatial_index_root_size = 256.0f;
+			// number of times the largest nodes are halved, down to the smallest ones
+			std::size_t m_spatial_index_max_depth = 8;
+		};
+
+		struct object_create_info
+		{
+			// objects with a mesh own an instance of it, kept at the global transformation of the object
+			// the mesh is either owned by the scene or needs to outlive the object
+			non_owning_ptr<lh::mesh> m_mesh = nullptr;
+			geometry::transformation_t m_transformation = geometry::transformation_t {1.0f};
+			// the object is attached to the root node if the parent handle is not valid
+			handle m_parent = {};
+		};
+
+		scene(const create_info& = {});
+		scene(const scene&) = delete;
+		auto operator=(const scene&) -> scene& = delete;
+
+		auto create_object(const object_create_info&) -> handle;
+		// parents need to exist before the call, the objects of the batch can not parent each other
+		auto create_objects(std::span<const object_create_info>) -> std::vector<handle>;
+		// children of destroyed objects are attached to the parent of the destroyed object
+		auto destroy_object(const handle&) -> void;
+		auto destroy_objects(std::span<const handle>) -> void;
+		// objects are attached to the root node if the parent handle is not valid
+		// reparenting an object to one of its descendants is refused
+		auto reparent_object(const handle&, const handle& parent) -> void;
+		auto reparent_objects(std::span<const handle>, const handle& parent) -> void;
+		// the transformation of scene objects needs to be changed through the scene, so that moves are tracked
+		auto transform_object(const handle&, const geometry::transformation_t&) -> void;
+
+		auto valid(const handle&) const -> bool;
+		auto node(const handle&) const -> const lh::node&;
+		auto mesh(const handle&) const -> non_owning_ptr<const lh::mesh>;
+		// world space bounds as of the last update
+		auto bounds(const handle&) const -> const geometry::aabb&;
+		auto object_count() const -> const std::size_t;
+
+		// refreshes the bounds, spatial index entries and mesh instances of objects moved since the last update
+		// global transformations need to be up to date, so call it after the node hierarchy has been updated
+		auto update() -> void;
+		// objects whose bounds overlap the volume, as of the last update
+		auto objects_within(const geometry::aabb&) const -> std::vector<handle>;
+		auto objects_within(const geometry::sphere&) const -> std::vector<handle>;
+		auto objects_within(const geometry::frustum&) const -> std::vector<handle>;
+		// objects whose bounds the ray enters before reaching the distance, as of the last update
+		auto objects_along(const geometry::ray&,
+						   const geometry::scalar_t max_distance = std::numeric_limits<geometry::scalar_t>::infinity()) const
+			-> std::vector<handle>;
+
+		template <typename T, typename... Ts>
+			requires std::derived_from<T, physical_light>
+		auto add_light(Ts&&... ts) -> T&
+		{
+			auto& light = *m_lights.emplace_back(std::make_unique<T>(std::forward<Ts>(ts)...));
+
+			return static_cast<T&>(light);
+		}
+
+		template <typename... Ts>
+		auto add_mesh(Ts&&... ts) -> lh::mesh&
+		{
+			return *m_meshes.emplace_back(std::make_unique<lh::mesh>(std::forward<Ts>(ts)...));
+		}
+
+		// destroys the objects using the mesh along with it
+		auto remove_mesh(const lh::mesh&) -> void;
+		auto meshes() const -> const std::vector<std::unique_ptr<lh::mesh>>&;
+
+		auto remove_light(const physical_light&) -> void;
+		auto lights() const -> const std::vector<std::unique_ptr<physical_light>>&;
+
+		// the first camera added becomes the active one
+		auto add_camera(const camera_t::create_info<camera_type::perspective>& = {}) -> camera_t&;
+		auto remove_camera(const camera_t&) -> void;
+		auto active_camera(camera_t&) -> void;
+		auto active_camera() const -> camera_t&;
+		auto cameras() const -> const std::vector<std::unique_ptr<camera_t>>&;
 
 	private:
-		//auto generate_mesh_subdata(const scene_data&) const -> const vulkan::buffer_subdata<vulkan::buffer>;
+		// the spatial index is built from the create info, so it is validated before any member is constructed
+		static auto validated(const create_info&) -> create_info;
+
+		auto object_at(const handle&) const -> object&;
+		auto parent_node(const handle&) const -> lh::node&;
+		// queues the objects of the subtree for the next update, including the object itself
+		auto mark_moved(const lh::node&) -> void;
+		auto release(const handle&) -> void;
+
+		create_info m_create_info;
+
+		// declared ahead of the objects, which remove their instances from the meshes when destroyed
+		std::vector<std::unique_ptr<lh::mesh>> m_meshes;
+		object_pool<object> m_objects;
+		std::unordered_map<const lh::node*, handle> m_objects_by_node;
+		std::vector<handle> m_moved_objects;
+
+		geometry::loose_octree<handle> m_spatial_index;
 
-		vulkan::buffer m_mesh_buffer;
-		std::vector<mesh> m_meshes;
+		std::vector<std::unique_ptr<physical_light>> m_lights;
+		std::vector<std::unique_ptr<camera_t>> m_cameras;
+		non_owning_ptr<camera_t> m_active_camera;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,147 @@
+module;
+
+#if INTELLISENSE
+#include "glm/mat4x4.hpp"
+#endif
+
+export module transform_hierarchy;
+
+import geometry;
+import job_system;
+
+#if not INTELLISENSE
+import glm;
+#endif
+
+import std;
+
+export namespace lh
+{
+	// data oriented storage of a transformation hierarchy
+	// transformations are stored as structure of arrays, ordered depth first with every parent preceding its
+	// subtree, so that subtrees occupy contiguous ranges and global transformations are updated in a single sweep
+	// entries are also linked to their parents, children and siblings, so that structural changes only relink them
+	// changes that break the order are cheap, the order is restored in a single pass by the next update
+	// handles stay valid while entries move around, they are only invalidated by destruction
+	// destroyed entries are left in place and compacted away during updates
+	class transform_hierarchy
+	{
+	public:
+		using index_t = std::uint32_t;
+		using generation_t = std::uint32_t;
+
+		struct handle
+		{
+			auto operator==(const handle&) const -> bool = default;
+
+			index_t m_index = std::numeric_limits<index_t>::max();
+			generation_t m_generation = 0;
+		};
+
+		transform_hierarchy(const std::size_t initial_capacity = 0);
+
+		// null parent handles create top level entries
+		// entries are appended to the storage, those not created under the most recently created ones or at the top
+		// level break the order
+		auto create(const handle& parent, const geometry::transformation_t& = geometry::transformation_t {1.0f}) -> handle;
+		// destroys the entry along with its whole subtree
+		auto destroy(const handle&) -> void;
+		// destroys the entry alone, its children are attached to its parent
+		auto collapse(const handle&) -> void;
+		// attaches the entry along with its subtree as the last child of the new parent, and breaks the order
+		// takes time proportional to the depth of the new parent, and the size of the subtree it invalidates
+		// null parent handles move it to the top level
+		auto reparent(const handle&, const handle& parent) -> void;
+
+		auto valid(const handle&) const -> bool;
+		auto parent(const handle&) const -> handle;
+		auto size() const -> const std::size_t;
+
+		// invalidates the global transformations of the whole subtree
+		auto local_transformation(const handle&, const geometry::transformation_t&) -> void;
+		auto local_transformation(const handle&) const -> const geometry::transformation_t&;
+		// recalculated along the invalid part of the parent chain, if needed
+		// references into the hierarchy are invalidated by creating, destroying, updating or compacting its nodes
+		auto global_transformation(const handle&) -> const geometry::transformation_t&;
+
+		// recalculates every invalid global transformation, in a single linear sweep
+		auto update() -> void;
+		// recalculates every invalid global transformation, independent subtrees are swept by parallel jobs
+		// large subtrees are split below their top entries, results are identical to the single threaded update
+		auto update(job_system&) -> void;
+		// recalculates every invalid global transformation within the subtree
+		auto update(const handle&) -> void;
+		// restores the order and removes destroyed entries, done by updates once the order is broken, or once
+		// destroyed entries make up a quarter of the storage
+		auto compact() -> void;
+
+	private:
+		static inline constexpr auto s_null_index = std::numeric_limits<index_t>::max();
+		static inline constexpr auto s_min_entries_per_job = index_t {4096};
+
+		struct slot
+		{
+			index_t m_index;
+			generation_t m_generation;
+		};
+
+		auto index(const handle&) const -> index_t;
+		auto recalculate(const index_t) -> void;
+		auto invalidate(const index_t) -> void;
+		// recalculates the invalid entries of the range, parents outside of it need to be up to date
+		auto sweep(const index_t, const index_t) -> void;
+		auto release(const index_t) -> void;
+
+		// appends the entry to the children of the parent, or to the top level entries for null parents
+		auto link(const index_t, const index_t parent) -> void;
+		auto unlink(const index_t) -> void;
+		auto first_child(const index_t parent) -> index_t&;
+		auto last_child(const index_t parent) -> index_t&;
+		auto add_to_ancestor_sizes(const index_t, const std::int64_t) -> void;
+
+		// calls the function with every entry of the subtree, parents before their children, following the links
+		template <typename F>
+		auto for_each_in_subtree(const index_t entry, const F& function) const -> void
+		{
+			for (auto current = entry;;)
+			{
+				function(current);
+
+				if (m_first_children[current] != s_null_index)
+				{
+					current = m_first_children[current];
+					continue;
+				}
+
+				while (current != entry and m_next_siblings[current] == s_null_index)
+					current = m_parents[current];
+
+				if (current == entry) return;
+
+				current = m_next_siblings[current];
+			}
+		}
+
+		std::vector<geometry::transformation_t> m_local_transformations;
+		std::vector<geometry::transformation_t> m_global_transformations;
+		std::vector<index_t> m_parents;
+		// number of entries within the subtree, the entry itself and destroyed ones included, while ordered
+		std::vector<index_t> m_subtree_sizes;
+		std::vector<std::uint8_t> m_invalid;
+		// slot of each entry, null for destroyed entries
+		std::vector<index_t> m_slots_of_entries;
+		// destroyed entries are unlinked, top level entries are linked as siblings of each other
+		std::vector<index_t> m_first_children;
+		std::vector<index_t> m_last_children;
+		std::vector<index_t> m_previous_siblings;
+		std::vector<index_t> m_next_siblings;
+		index_t m_first_top_level_entry;
+		index_t m_last_top_level_entry;
+		// entries are in depth first order and subtree sizes are up to date
+		bool m_ordered;
+
+		std::vector<slot> m_slots;
+		std::vector<index_t> m_free_slots;
+		std::size_t m_destroyed_count;
+	};
+}
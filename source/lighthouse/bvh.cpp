@@ -0,0 +1,491 @@
+module;
+
+module bvh;
+
+import vertex_format;
+import index_format;
+import output;
+import bounding_volume;
+
+namespace
+{
+	using lh::geometry::aabb;
+	using lh::geometry::position_t;
+	using lh::geometry::scalar_t;
+	using lh::geometry::infinity;
+
+	// distance at which the ray enters the bounds, infinity if it misses them or enters past the maximum distance
+	auto entry_distance(const aabb& bounds,
+						const position_t& position,
+						const lh::geometry::vec3_t& inverse_direction,
+						const scalar_t max_distance) -> scalar_t
+	{
+		const auto nearer = (bounds.m_minima - position) * inverse_direction;
+		const auto farther = (bounds.m_maxima - position) * inverse_direction;
+		const auto entry = glm::min(nearer, farther);
+		const auto exit = glm::max(nearer, farther);
+
+		const auto entering = std::max({entry.x, entry.y, entry.z, scalar_t {}});
+		const auto exiting = std::min({exit.x, exit.y, exit.z, max_distance});
+
+		return entering <= exiting ? entering : infinity;
+	}
+
+	auto intersect(const lh::geometry::ray& ray, const lh::geometry::triangle& triangle) -> lh::collision::ray_hit
+	{
+		const auto edge_1 = triangle.m_y - triangle.m_x;
+		const auto edge_2 = triangle.m_z - triangle.m_x;
+		const auto p = glm::cross(ray.m_direction, edge_2);
+		const auto determinant = glm::dot(edge_1, p);
+
+		if (std::abs(determinant) <= lh::geometry::epsilon) return {};
+
+		const auto inverse_determinant = 1.0f / determinant;
+		const auto s = ray.m_position - triangle.m_x;
+		const auto u = glm::dot(s, p) * inverse_determinant;
+
+		if (u < 0.0f or u > 1.0f) return {};
+
+		const auto q = glm::cross(s, edge_1);
+		const auto v = glm::dot(ray.m_direction, q) * inverse_determinant;
+
+		if (v < 0.0f or u + v > 1.0f) return {};
+
+		const auto t = glm::dot(edge_2, q) * inverse_determinant;
+
+		if (t <= lh::geometry::epsilon) return {};
+
+		return {t, u, v, 0};
+	}
+
+	auto indexed_triangles(std::span<const position_t> positions, std::span<const std::uint32_t> indices)
+		-> std::vector<lh::geometry::triangle>
+	{
+		auto triangles = std::vector<lh::geometry::triangle> {};
+		triangles.reserve(indices.size() / 3);
+
+		auto out_of_range = false;
+		const auto position_of = [&positions, &out_of_range](const std::uint32_t index) {
+			if (index < positions.size()) return positions[index];
+
+			out_of_range = true;
+			return position_t {};
+		};
+
+		for (auto i = std::size_t {}; i + 2 < indices.size(); i += 3)
+			triangles.emplace_back(position_of(indices[i]), position_of(indices[i + 1]), position_of(indices[i + 2]));
+
+		// degenerate triangles take the place of invalid ones, so that triangle indices still match the source data
+		if (out_of_range) lh::output::warning() << "bvh triangle indices are out of range of the vertex positions";
+
+		return triangles;
+	}
+
+	auto mesh_triangles(const lh::scene_data& scene_data, const std::size_t mesh_index)
+		-> std::vector<lh::geometry::triangle>
+	{
+		if (mesh_index >= scene_data.mesh_data().size())
+		{
+			lh::output::error() << "bvh mesh index is out of range of the scene data";
+			return {};
+		}
+
+		constexpr auto vertex_size = sizeof(lh::vulkan::vertex);
+		constexpr auto index_size = sizeof(lh::vulkan::vertex_index_t);
+
+		const auto& mesh_data = scene_data.mesh_data()[mesh_index];
+		const auto vertex_data = scene_data.vertex_data().data();
+
+		auto positions = std::vector<position_t>(mesh_data.m_vertex_buffer_size / vertex_size);
+		auto indices = std::vector<std::uint32_t>(mesh_data.m_index_buffer_size / index_size);
+
+		// vertices are interleaved, positions are gathered at the vertex stride
+		for (auto v = std::size_t {}; v < positions.size(); v++)
+		{
+			auto vertex = lh::vulkan::vertex {};
+
+			std::memcpy(&vertex, vertex_data + mesh_data.m_vertex_offset + v * vertex_size, vertex_size);
+			positions[v] = vertex.m_position;
+		}
+
+		std::memcpy(indices.data(), vertex_data + mesh_data.m_index_offset, indices.size() * index_size);
+
+		return indexed_triangles(positions, indices);
+	}
+}
+
+namespace lh
+{
+	namespace geometry
+	{
+		static_assert(sizeof(bvh::node) == 32);
+
+		bvh::bvh(std::span<const triangle> triangles, const create_info& create_info)
+			: m_create_info {create_info}, m_nodes {}, m_triangles {}, m_triangle_indices {}
+		{
+			m_create_info.m_max_leaf_triangles = std::max(m_create_info.m_max_leaf_triangles, std::uint16_t {1});
+			m_create_info.m_bin_count = std::clamp(m_create_info.m_bin_count, std::size_t {2}, s_max_bin_count);
+
+			if (triangles.size() > std::numeric_limits<std::uint32_t>::max())
+			{
+				output::error() << "bvh triangle count exceeds the range of triangle indices";
+				return;
+			}
+
+			build(triangles);
+		}
+
+		bvh::bvh(std::span<const position_t> positions,
+				 std::span<const std::uint32_t> indices,
+				 const create_info& create_info)
+			: bvh {indexed_triangles(positions, indices), create_info}
+		{}
+
+		bvh::bvh(const scene_data& scene_data, const std::size_t mesh_index, const create_info& create_info)
+			: bvh {mesh_triangles(scene_data, mesh_index), create_info}
+		{}
+
+		auto bvh::closest_hit(const ray& ray, const scalar_t max_distance) const -> collision::ray_hit
+		{
+			auto result = collision::ray_hit {max_distance};
+
+			if (m_nodes.empty()) return {};
+
+			struct entry
+			{
+				std::uint32_t m_node;
+				scalar_t m_distance;
+			};
+
+			const auto inverse_direction = vec3_t {1.0f} / ray.m_direction;
+
+			auto stack = std::array<entry, s_traversal_stack_size> {};
+			auto stack_size = std::size_t {};
+			auto current = entry {0, entry_distance(m_nodes.front().m_bounds, ray.m_position, inverse_direction, max_distance)};
+
+			while (true)
+			{
+				if (current.m_distance < result.m_distance)
+				{
+					const auto& node = m_nodes[current.m_node];
+
+					if (node.leaf())
+					{
+						for (auto i = node.m_offset; i < node.m_offset + node.m_triangle_count; i++)
+						{
+							const auto hit = intersect(ray, m_triangles[i]);
+
+							if (hit.m_distance < result.m_distance)
+								result = {hit.m_distance, hit.m_u, hit.m_v, m_triangle_indices[i]};
+						}
+					}
+					else
+					{
+						auto nearer = entry {current.m_node + 1,
+										   entry_distance(m_nodes[current.m_node + 1].m_bounds,
+														  ray.m_position,
+														  inverse_direction,
+														  result.m_distance)};
+						auto farther = entry {
+							node.m_offset,
+							entry_distance(m_nodes[node.m_offset].m_bounds, ray.m_position, inverse_direction, result.m_distance)};
+
+						if (farther.m_distance < nearer.m_distance) std::swap(nearer, farther);
+
+						// the farther child is revisited later, when the nearer one might have found a closer hit
+						if (farther.m_distance < result.m_distance) stack[stack_size++] = farther;
+
+						current = nearer;
+						continue;
+					}
+				}
+
+				if (stack_size == 0) break;
+
+				current = stack[--stack_size];
+			}
+
+			return result.hit() ? result : collision::ray_hit {};
+		}
+
+		auto bvh::any_hit(const ray& ray, const scalar_t max_distance) const -> bool
+		{
+			if (m_nodes.empty()) return false;
+
+			const auto inverse_direction = vec3_t {1.0f} / ray.m_direction;
+
+			auto stack = std::array<std::uint32_t, s_traversal_stack_size> {};
+			auto stack_size = std::size_t {1};
+
+			while (stack_size)
+			{
+				const auto& node = m_nodes[stack[--stack_size]];
+
+				if (entry_distance(node.m_bounds, ray.m_position, inverse_direction, max_distance) == infinity) continue;
+
+				if (node.leaf())
+				{
+					for (auto i = node.m_offset; i < node.m_offset + node.m_triangle_count; i++)
+						if (intersect(ray, m_triangles[i]).m_distance < max_distance) return true;
+				}
+				else
+				{
+					stack[stack_size++] = node.m_offset;
+					stack[stack_size++] = static_cast<std::uint32_t>(&node - m_nodes.data()) + 1;
+				}
+			}
+
+			return false;
+		}
+
+		auto bvh::closest_hits(const packet_t& packet, const scalar_t max_distance) const -> packet_hits_t
+		{
+			auto hits = packet_hits_t {};
+
+			for (auto& hit : hits)
+				hit.m_distance = max_distance;
+
+			if (m_nodes.empty()) return packet_hits_t {};
+
+			using lanes_t = packet_t::lanes_t;
+
+			alignas(sizeof(lanes_t)) auto inverse_direction = std::array<lanes_t, 3> {};
+
+			for (auto axis = 0; axis < 3; axis++)
+				for (auto lane = std::size_t {}; lane < s_packet_width; lane++)
+					inverse_direction[axis][lane] = 1.0f / packet.m_direction[axis][lane];
+
+			// a node is visited if any ray of the packet enters it before reaching its nearest hit so far
+			const auto any_lane_enters = [&packet, &inverse_direction, &hits](const aabb& bounds) {
+				auto enters = false;
+
+				for (auto lane = std::size_t {}; lane < s_packet_width; lane++)
+				{
+					auto entering = scalar_t {};
+					auto exiting = hits[lane].m_distance;
+
+					for (auto axis = 0; axis < 3; axis++)
+					{
+						const auto nearer = (bounds.m_minima[axis] - packet.m_position[axis][lane]) * inverse_direction[axis][lane];
+						const auto farther = (bounds.m_maxima[axis] - packet.m_position[axis][lane]) * inverse_direction[axis][lane];
+
+						entering = std::max(entering, std::min(nearer, farther));
+						exiting = std::min(exiting, std::max(nearer, farther));
+					}
+
+					enters |= entering <= exiting;
+				}
+
+				return enters;
+			};
+
+			auto stack = std::array<std::uint32_t, s_traversal_stack_size> {};
+			auto stack_size = std::size_t {1};
+
+			while (stack_size)
+			{
+				const auto node_index = stack[--stack_size];
+				const auto& node = m_nodes[node_index];
+
+				if (not any_lane_enters(node.m_bounds)) continue;
+
+				if (node.leaf())
+				{
+					for (auto i = node.m_offset; i < node.m_offset + node.m_triangle_count; i++)
+						collision::ray_packet_tri_test(packet, m_triangles[i], m_triangle_indices[i], hits);
+				}
+				else
+				{
+					// the packet is assumed coherent, so the first ray decides which child is nearer
+					const auto first_child_nearer = packet.m_direction[node.m_axis][0] >= 0.0f;
+
+					stack[stack_size++] = first_child_nearer ? node.m_offset : node_index + 1;
+					stack[stack_size++] = first_child_nearer ? node_index + 1 : node.m_offset;
+				}
+			}
+
+			for (auto& hit : hits)
+				if (not hit.hit()) hit = {};
+
+			return hits;
+		}
+
+		auto bvh::bounds() const -> const aabb&
+		{
+			static const auto no_bounds = aabb {};
+
+			return m_nodes.empty() ? no_bounds : m_nodes.front().m_bounds;
+		}
+
+		auto bvh::nodes() const -> std::span<const node>
+		{
+			return m_nodes;
+		}
+
+		auto bvh::triangle_count() const -> const std::size_t
+		{
+			return m_triangles.size();
+		}
+
+		auto bvh::build(std::span<const triangle> triangles) -> void
+		{
+			if (triangles.empty()) return;
+
+			auto triangle_bounds = std::vector<aabb> {};
+			auto centroids = std::vector<position_t> {};
+
+			triangle_bounds.reserve(triangles.size());
+			centroids.reserve(triangles.size());
+
+			for (const auto& triangle : triangles)
+			{
+				auto& bounds = triangle_bounds.emplace_back(empty_bounds());
+
+				bounds = merge(bounds, triangle.m_x);
+				bounds = merge(bounds, triangle.m_y);
+				bounds = merge(bounds, triangle.m_z);
+
+				centroids.push_back((bounds.m_minima + bounds.m_maxima) * 0.5f);
+			}
+
+			m_triangle_indices.resize(triangles.size());
+			std::iota(m_triangle_indices.begin(), m_triangle_indices.end(), std::uint32_t {});
+
+			// a binary tree with at least one triangle per leaf has fewer than twice as many nodes as triangles
+			m_nodes.reserve(2 * triangles.size() - 1);
+
+			build_node(triangle_bounds, centroids, 0, static_cast<std::uint32_t>(triangles.size()), 0);
+
+			m_nodes.shrink_to_fit();
+			m_triangles.reserve(triangles.size());
+
+			for (const auto index : m_triangle_indices)
+				m_triangles.push_back(triangles[index]);
+		}
+
+		auto bvh::build_node(std::span<const aabb> triangle_bounds,
+							 std::span<const position_t> centroids,
+							 const std::uint32_t first,
+							 const std::uint32_t count,
+							 const std::size_t depth) -> void
+		{
+			const auto node_index = m_nodes.size();
+			auto bounds = empty_bounds();
+			auto centroid_bounds = empty_bounds();
+
+			const auto triangles = std::span {m_triangle_indices}.subspan(first, count);
+
+			for (const auto index : triangles)
+			{
+				bounds = merge(bounds, triangle_bounds[index]);
+				centroid_bounds = merge(centroid_bounds, centroids[index]);
+			}
+
+			m_nodes.push_back({bounds, first, static_cast<std::uint16_t>(count), 0});
+
+			if (count == 1) return;
+
+			struct bin
+			{
+				aabb m_bounds = empty_bounds();
+				std::uint32_t m_count = 0;
+			};
+
+			const auto bin_count = m_create_info.m_bin_count;
+			const auto bins_per_unit =
+				vec3_t {static_cast<scalar_t>(bin_count)} / (centroid_bounds.m_maxima - centroid_bounds.m_minima);
+			const auto bin_of = [&centroid_bounds, &bins_per_unit, bin_count](const position_t& centroid,
+																			   const std::size_t axis) {
+				const auto bin = static_cast<std::size_t>((centroid[axis] - centroid_bounds.m_minima[axis]) *
+														  bins_per_unit[axis]);
+
+				return std::min(bin, bin_count - 1);
+			};
+
+			auto best_axis = std::size_t {};
+			auto best_split = std::size_t {};
+			auto best_cost = infinity;
+
+			// split candidates are the boundaries between bins, each scored by the surface area heuristic
+			for (auto axis = std::size_t {}; axis < 3 and depth < s_max_sah_depth; axis++)
+			{
+				if (centroid_bounds.m_maxima[axis] <= centroid_bounds.m_minima[axis]) continue;
+
+				auto bins = std::array<bin, s_max_bin_count> {};
+
+				for (const auto index : triangles)
+				{
+					auto& bin = bins[bin_of(centroids[index], axis)];
+
+					bin.m_bounds = merge(bin.m_bounds, triangle_bounds[index]);
+					bin.m_count++;
+				}
+
+				// costs of the bins left of each boundary, swept from the left
+				auto left_costs = std::array<scalar_t, s_max_bin_count> {};
+				auto left_bounds = empty_bounds();
+				auto left_count = std::uint32_t {};
+
+				for (auto split = std::size_t {1}; split < bin_count; split++)
+				{
+					left_bounds = merge(left_bounds, bins[split - 1].m_bounds);
+					left_count += bins[split - 1].m_count;
+					left_costs[split] = left_count ? surface_area(left_bounds) * static_cast<scalar_t>(left_count) : 0.0f;
+				}
+
+				auto right_bounds = empty_bounds();
+				auto right_count = std::uint32_t {};
+
+				for (auto split = bin_count - 1; split > 0; split--)
+				{
+					right_bounds = merge(right_bounds, bins[split].m_bounds);
+					right_count += bins[split].m_count;
+
+					if (right_count == 0 or right_count == count) continue;
+
+					const auto cost = left_costs[split] + surface_area(right_bounds) * static_cast<scalar_t>(right_count);
+
+					if (cost < best_cost)
+					{
+						best_axis = axis;
+						best_split = split;
+						best_cost = cost;
+					}
+				}
+			}
+
+			const auto area = surface_area(bounds);
+			const auto split_cost = area > 0.0f ? m_create_info.m_traversal_cost + best_cost / area : best_cost;
+
+			if (count <= m_create_info.m_max_leaf_triangles and split_cost >= static_cast<scalar_t>(count)) return;
+
+			auto middle = triangles.begin();
+
+			if (best_cost < infinity)
+				middle = std::partition(triangles.begin(), triangles.end(), [&](const std::uint32_t index) {
+					return bin_of(centroids[index], best_axis) < best_split;
+				});
+			else
+			{
+				// no useful split was found, or the depth is too large for one, the triangles are halved along the widest axis
+				const auto extent = centroid_bounds.m_maxima - centroid_bounds.m_minima;
+
+				best_axis = extent.x >= extent.y and extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+				middle = triangles.begin() + count / 2;
+
+				std::nth_element(triangles.begin(), middle, triangles.end(), [&](const std::uint32_t a, const std::uint32_t b) {
+					return centroids[a][best_axis] < centroids[b][best_axis];
+				});
+			}
+
+			const auto left_count = static_cast<std::uint32_t>(middle - triangles.begin());
+
+			m_nodes[node_index].m_triangle_count = 0;
+			m_nodes[node_index].m_axis = static_cast<std::uint16_t>(best_axis);
+
+			build_node(triangle_bounds, centroids, first, left_count, depth + 1);
+			m_nodes[node_index].m_offset = static_cast<std::uint32_t>(m_nodes.size());
+			build_node(triangle_bounds, centroids, first + left_count, count - left_count, depth + 1);
+		}
+	}
+}
@@ -0,0 +1,147 @@
+module;
+
+module ecs;
+
+namespace lh
+{
+	namespace ecs
+	{
+		auto next_component_id() -> component_id_t
+		{
+			static auto next_id = component_id_t {};
+
+			return next_id++;
+		}
+
+		auto archetype::column_index(const component_id_t id) const -> std::size_t
+		{
+			const auto component = std::ranges::lower_bound(m_signature, id);
+
+			if (component == m_signature.end() or *component != id) return s_npos;
+
+			return static_cast<std::size_t>(component - m_signature.begin());
+		}
+
+		world::world() : m_archetypes {}, m_archetypes_by_signature {}, m_records {}, m_free_records {}
+		{
+			// entities without components
+			m_archetypes.emplace_back(std::make_unique<archetype>());
+			m_archetypes_by_signature.emplace(std::vector<component_id_t> {}, m_archetypes.back().get());
+		}
+
+		auto world::create() -> entity
+		{
+			auto& empty_archetype = *m_archetypes.front();
+			auto index = static_cast<entity::index_t>(m_records.size());
+
+			if (m_free_records.empty())
+				m_records.emplace_back(nullptr, 0, entity::generation_t {});
+			else
+			{
+				index = m_free_records.back();
+				m_free_records.pop_back();
+			}
+
+			auto& record = m_records[index];
+			const auto created = entity {index, record.m_generation};
+
+			record.m_archetype = &empty_archetype;
+			record.m_row = empty_archetype.m_entities.size();
+			empty_archetype.m_entities.push_back(created);
+
+			return created;
+		}
+
+		auto world::destroy(const entity& entity) -> void
+		{
+			if (not valid(entity)) return;
+
+			auto& record = m_records[entity.m_index];
+
+			erase_row(*record.m_archetype, record.m_row);
+
+			record.m_archetype = nullptr;
+			record.m_generation++;
+			m_free_records.push_back(entity.m_index);
+		}
+
+		auto world::valid(const entity& entity) const -> bool
+		{
+			return entity.m_index < m_records.size() and m_records[entity.m_index].m_archetype and
+				   m_records[entity.m_index].m_generation == entity.m_generation;
+		}
+
+		auto world::size() const -> const std::size_t
+		{
+			return m_records.size() - m_free_records.size();
+		}
+
+		auto world::archetypes() const -> const std::vector<std::unique_ptr<archetype>>&
+		{
+			return m_archetypes;
+		}
+
+		auto world::find_or_create_archetype(const std::vector<component_id_t>& signature,
+											 const archetype& source,
+											 const column_factory_t& column_factory) -> non_owning_ptr<archetype>
+		{
+			if (const auto existing = m_archetypes_by_signature.find(signature);
+				existing != m_archetypes_by_signature.end())
+				return existing->second;
+
+			auto& created = *m_archetypes.emplace_back(std::make_unique<archetype>());
+
+			created.m_signature = signature;
+			created.m_columns.reserve(signature.size());
+
+			for (const auto id : signature)
+			{
+				const auto source_column = source.column_index(id);
+
+				created.m_columns.push_back(source_column == archetype::s_npos
+												? column_factory(id)
+												: source.m_columns[source_column]->create_empty());
+			}
+
+			m_archetypes_by_signature.emplace(signature, &created);
+
+			return &created;
+		}
+
+		auto world::move_entity(const entity& entity, archetype& destination) -> void
+		{
+			auto& record = m_records[entity.m_index];
+			auto& source = *record.m_archetype;
+
+			for (auto i = std::size_t {}; i < source.m_signature.size(); i++)
+			{
+				const auto destination_column = destination.column_index(source.m_signature[i]);
+
+				if (destination_column != archetype::s_npos)
+					source.m_columns[i]->move_to(*destination.m_columns[destination_column], record.m_row);
+			}
+
+			const auto row = record.m_row;
+
+			record.m_archetype = &destination;
+			record.m_row = destination.m_entities.size();
+			destination.m_entities.push_back(entity);
+
+			erase_row(source, row);
+		}
+
+		auto world::erase_row(archetype& archetype, const std::size_t row) -> void
+		{
+			for (auto& column : archetype.m_columns)
+				column->erase(row);
+
+			const auto moved = archetype.m_entities.back();
+
+			archetype.m_entities[row] = moved;
+			archetype.m_entities.pop_back();
+
+			// the last entity took over the row, unless the erased row was the last one
+			if (row < archetype.m_entities.size()) m_records[moved.m_index].m_row = row;
+		}
+	}
+}
@@ -8,11 +8,16 @@ import file_system;
 import output;
 import input;
 import time;
+import node;
+import entity;
 
 namespace lh
 {
 	engine::engine(std::unique_ptr<lh::window> window, const create_info& engine_create_info)
-		: m_window {std::move(window)}, m_renderer {}, m_version(engine_create_info.m_engine_version)
+		: m_window {std::move(window)},
+		  m_renderer {},
+		  m_job_system {std::make_unique<lh::job_system>(engine_create_info.m_job_system_create_info)},
+		  m_version(engine_create_info.m_engine_version)
 	{
 		file_system::initialize();
 		input::initialize(*m_window);
@@ -35,6 +40,8 @@ namespace lh
 		{
 			poll_events();
 			input::key_binding::execute_pressed_keys();
+			entity::compose_pending_transformations();
+			node::root_node().update_global_transformations(*m_job_system);
 			m_renderer->render();
 		}
 	}
@@ -68,4 +75,9 @@ namespace lh
 	{
 		return m_version;
 	}
+
+	auto engine::job_system() -> lh::job_system&
+	{
+		return *m_job_system;
+	}
 }
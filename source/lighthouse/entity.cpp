@@ -5,22 +5,17 @@ module entity;
 namespace lh
 {
 	entity::entity(std::shared_ptr<node> node)
-		: m_node {node},
-		  m_position {},
+		: m_position {},
 		  m_orientation {1.0f, 0.0f, 0.0f, 0.0f},
 		  m_scale {1.0f, 1.0f, 1.0f},
-		  m_node_requires_reconstruction {false}
-	{
-		// if node transformation is not an identity transformation
-		// it needs to be decomposed into components
-		if (node->local_transformation() != geometry::transformation_t {1.0f})
-		{
-			auto skew = glm::vec3 {};
-			auto perspective = glm::vec4 {};
-
-			glm::decompose(node->local_transformation(), m_scale, m_orientation, m_position, skew, perspective);
-		}
-	}
+		  m_node_requires_reconstruction {false},
+		  m_components_require_decomposition {node->local_transformation() != geometry::transformation_t {1.0f}},
+		  m_reconstruction_queue_index {s_not_queued},
+		  m_change_notification {change_notification::immediate},
+		  m_deferred_changes {},
+		  m_change_queue_index {s_not_queued},
+		  m_node {node}
+	{}
 
 	entity::entity(const geometry::position_t& position,
 				   const geometry::normal_t rotation,
@@ -28,102 +23,221 @@ namespace lh
 		: m_position {position},
 		  m_orientation {rotation},
 		  m_scale {scale},
-		  m_node_requires_reconstruction {true},
-		  m_node {std::make_shared<node>()}
-	{}
+		  m_node_requires_reconstruction {false},
+		  m_components_require_decomposition {false},
+		  m_reconstruction_queue_index {s_not_queued},
+		  m_change_notification {change_notification::immediate},
+		  m_deferred_changes {},
+		  m_change_queue_index {s_not_queued},
+		  m_node {make_pooled<node>()}
+	{
+		request_reconstruction();
+	}
+
+	entity::~entity()
+	{
+		if (m_reconstruction_queue_index != s_not_queued)
+			s_pending_reconstructions[m_reconstruction_queue_index] = nullptr;
+
+		if (m_change_queue_index != s_not_queued) s_changed_entities[m_change_queue_index] = nullptr;
+	}
+
+	auto entity::compose_pending_transformations() -> void
+	{
+		auto positions = std::vector<geometry::position_t> {};
+		auto rotations = std::vector<geometry::quaternion_t> {};
+		auto scales = std::vector<geometry::scale_t> {};
+
+		// entities destroyed or composed on demand in the meantime are skipped
+		std::erase_if(s_pending_reconstructions, [](entity* entity) {
+			if (not entity) return true;
+
+			entity->m_reconstruction_queue_index = s_not_queued;
+
+			return not entity->m_node_requires_reconstruction;
+		});
+
+		positions.reserve(s_pending_reconstructions.size());
+		rotations.reserve(s_pending_reconstructions.size());
+		scales.reserve(s_pending_reconstructions.size());
+
+		for (const auto entity : s_pending_reconstructions)
+		{
+			positions.push_back(entity->m_position);
+			rotations.push_back(entity->m_orientation);
+			scales.push_back(entity->m_scale);
+		}
+
+		auto transformations = std::vector<geometry::transformation_t>(s_pending_reconstructions.size());
+
+		geometry::compose_transformations(positions, rotations, scales, transformations);
+
+		for (auto i = std::size_t {}; i < s_pending_reconstructions.size(); i++)
+		{
+			s_pending_reconstructions[i]->m_node->local_transformation(transformations[i]);
+			s_pending_reconstructions[i]->m_node_requires_reconstruction = false;
+		}
+
+		s_pending_reconstructions.clear();
+	}
+
+	auto entity::dispatch_deferred_changes() -> void
+	{
+		// hooks may change entities further, those appended meanwhile are dispatched as well
+		// entities destroyed meanwhile, or switched to immediate notification, left null entries
+		for (auto i = std::size_t {}; i < s_changed_entities.size(); i++)
+		{
+			if (not s_changed_entities[i]) continue;
+
+			auto& entity = *s_changed_entities[i];
+
+			entity.m_change_queue_index = s_not_queued;
+			entity.dispatch_changes(std::exchange(entity.m_deferred_changes, std::uint8_t {}));
+		}
+
+		s_changed_entities.clear();
+	}
+
+	auto entity::notification_mode(const change_notification change_notification) -> void
+	{
+		m_change_notification = change_notification;
+
+		if (m_change_notification == change_notification::immediate and m_change_queue_index != s_not_queued)
+		{
+			s_changed_entities[std::exchange(m_change_queue_index, s_not_queued)] = nullptr;
+
+			dispatch_changes(std::exchange(m_deferred_changes, std::uint8_t {}));
+		}
+	}
+
+	auto entity::notification_mode() const -> const change_notification
+	{
+		return m_change_notification;
+	}
 
 	auto entity::position() const -> const geometry::position_t&
 	{
+		decompose_node();
+
 		return m_position;
 	}
 
 	auto entity::rotation() const -> const geometry::normal_t
 	{
+		decompose_node();
+
 		return glm::eulerAngles(m_orientation);
 	}
 
 	auto entity::orientation() const -> const geometry::rotation_t&
 	{
+		decompose_node();
+
 		return m_orientation;
 	}
 
 	auto entity::scale() const -> const geometry::scale_t&
 	{
+		decompose_node();
+
 		return m_scale;
 	}
 
 	auto entity::translate_relative(const geometry::position_t& translation) -> void
 	{
+		decompose_node();
+
 		m_position += translation;
-		m_node_requires_reconstruction = true;
+		request_reconstruction();
 
-		on_position_change();
+		notify_change(s_position_change);
 	}
 
 	auto entity::translate_relative(const geometry::normal_t& rotation, geometry::scalar_t magnitude) -> void
 	{
+		decompose_node();
+
 		m_position += rotation * magnitude;
-		m_node_requires_reconstruction = true;
+		request_reconstruction();
 
-		on_position_change();
+		notify_change(s_position_change);
 	}
 
 	auto entity::rotate_relative(const geometry::normal_t& rotation) -> void
 	{
+		decompose_node();
+
 		m_orientation = m_orientation * geometry::normal_t {rotation};
-		m_node_requires_reconstruction = true;
+		request_reconstruction();
 
-		on_rotation_change();
+		notify_change(s_rotation_change);
 	}
 	auto entity::rotate_relative(const geometry::rotation_t& rotation) -> void
 	{
+		decompose_node();
+
 		m_orientation = m_orientation * rotation;
-		m_node_requires_reconstruction = true;
-		on_rotation_change();
+		request_reconstruction();
+		notify_change(s_rotation_change);
 	}
 
 	auto entity::scale_relative(const geometry::scale_t& scaling) -> void
 	{
+		decompose_node();
+
 		m_scale += scaling;
-		m_node_requires_reconstruction = true;
+		request_reconstruction();
 
-		on_scale_change();
+		notify_change(s_scale_change);
 	}
 
 	auto entity::translate_absolute(const geometry::position_t& translation) -> void
 	{
+		decompose_node();
+
 		m_position = translation;
-		m_node_requires_reconstruction = true;
+		request_reconstruction();
 
-		on_position_change();
+		notify_change(s_position_change);
 	}
 
 	auto entity::rotate_absolute(const geometry::normal_t& rotation) -> void
 	{
+		decompose_node();
+
 		m_orientation = geometry::normal_t {rotation};
+		request_reconstruction();
 
-		on_rotation_change();
+		notify_change(s_rotation_change);
 	}
 
 	auto entity::rotate_absolute(const geometry::rotation_t& rotation) -> void
 	{
+		decompose_node();
+
 		m_orientation = rotation;
-		m_node_requires_reconstruction = true;
+		request_reconstruction();
 
-		on_rotation_change();
+		notify_change(s_rotation_change);
 	}
 
 	auto entity::scale_absolute(const geometry::scale_t& scaling) -> void
 	{
+		decompose_node();
+
 		m_scale = scaling;
-		m_node_requires_reconstruction = true;
+		request_reconstruction();
 
-		on_scale_change();
+		notify_change(s_scale_change);
 	}
 
 	auto entity::local_transformation(const geometry::transformation_t& transformation) -> void
 	{
 		m_node->local_transformation(transformation);
+
+		// a pending reconstruction would overwrite the transformation
+		m_node_requires_reconstruction = false;
+		m_components_require_decomposition = true;
 	}
 
 	auto entity::local_transformation() const -> const geometry::transformation_t&
@@ -135,19 +249,62 @@ namespace lh
 
 	auto entity::global_transformation() const -> const geometry::transformation_t
 	{
+		if (m_node_requires_reconstruction) reconstruct_node();
+
 		return m_node->global_transformation();
 	}
 
 	auto entity::reconstruct_node() const -> void
 	{
-		auto transformation = geometry::transformation_t {1.0f};
+		m_node->local_transformation(geometry::compose_transformation(m_position, m_orientation, m_scale));
+
+		m_node_requires_reconstruction = false;
+	}
+
+	auto entity::decompose_node() const -> void
+	{
+		if (not m_components_require_decomposition) return;
 
-		const auto translate = glm::translate(transformation, m_position);
-		const auto rotate = glm::mat4_cast(m_orientation);
-		const auto scale = glm::scale(transformation, m_scale);
+		auto skew = glm::vec3 {};
+		auto perspective = glm::vec4 {};
 
-		m_node->local_transformation(scale * rotate * translate);
+		glm::decompose(m_node->local_transformation(), m_scale, m_orientation, m_position, skew, perspective);
 
-		m_node_requires_reconstruction = false;
+		m_components_require_decomposition = false;
+	}
+
+	auto entity::request_reconstruction() -> void
+	{
+		if (m_reconstruction_queue_index == s_not_queued)
+		{
+			m_reconstruction_queue_index = s_pending_reconstructions.size();
+			s_pending_reconstructions.push_back(this);
+		}
+
+		m_node_requires_reconstruction = true;
+	}
+
+	auto entity::notify_change(const std::uint8_t change) -> void
+	{
+		if (m_change_notification == change_notification::immediate)
+		{
+			dispatch_changes(change);
+			return;
+		}
+
+		if (m_change_queue_index == s_not_queued)
+		{
+			m_change_queue_index = s_changed_entities.size();
+			s_changed_entities.push_back(this);
+		}
+
+		m_deferred_changes |= change;
+	}
+
+	auto entity::dispatch_changes(const std::uint8_t changes) -> void
+	{
+		if (changes & s_position_change) on_position_change();
+		if (changes & s_rotation_change) on_rotation_change();
+		if (changes & s_scale_change) on_scale_change();
 	}
 }
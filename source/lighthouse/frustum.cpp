@@ -0,0 +1,244 @@
+module;
+
+module frustum;
+
+import output;
+
+namespace
+{
+	using lh::geometry::scalar_t;
+
+	constexpr auto lane_count = std::size_t {8};
+	using lanes_t = std::array<scalar_t, lane_count>;
+
+	// bounding volumes of a block in structure of arrays layout
+	// boxes have no radius and spheres have no extents, so both are tested by the same kernel
+	struct volume_block
+	{
+		alignas(sizeof(lanes_t)) std::array<lanes_t, 3> m_centers;
+		alignas(sizeof(lanes_t)) std::array<lanes_t, 3> m_extents;
+		alignas(sizeof(lanes_t)) lanes_t m_radii;
+	};
+
+	// plane normals, their absolute values and distances, broadcast once per cull
+	struct frustum_planes
+	{
+		frustum_planes(const lh::geometry::frustum& frustum)
+		{
+			for (auto i = std::size_t {}; i < frustum.m_planes.size(); i++)
+			{
+				const auto& plane = frustum.m_planes[i];
+
+				for (auto axis = 0; axis < 3; axis++)
+				{
+					m_normals[i][axis] = plane.m_normal[axis];
+					m_absolute_normals[i][axis] = std::abs(plane.m_normal[axis]);
+				}
+
+				m_distances[i] = plane.m_distance;
+			}
+		}
+
+		std::array<std::array<scalar_t, 3>, 6> m_normals;
+		std::array<std::array<scalar_t, 3>, 6> m_absolute_normals;
+		std::array<scalar_t, 6> m_distances;
+	};
+
+	// a volume is outside once its center lies farther behind any plane than the volume reaches
+	// the indices of the remaining lanes are compacted into the visible span, lane by lane without branches
+	auto cull_block(const frustum_planes& planes,
+					const volume_block& block,
+					const std::uint32_t first_index,
+					const std::size_t lanes,
+					std::span<std::uint32_t> visible,
+					std::size_t visible_count) -> std::size_t
+	{
+		alignas(sizeof(lanes_t)) auto inside = std::array<std::uint32_t, lane_count> {};
+
+		inside.fill(1);
+
+		for (auto p = std::size_t {}; p < planes.m_distances.size(); p++)
+		{
+			const auto [nx, ny, nz] = planes.m_normals[p];
+			const auto [ax, ay, az] = planes.m_absolute_normals[p];
+			const auto distance = planes.m_distances[p];
+
+			for (auto lane = std::size_t {}; lane < lane_count; lane++)
+			{
+				const auto signed_distance = nx * block.m_centers[0][lane] + ny * block.m_centers[1][lane] +
+											 nz * block.m_centers[2][lane] + distance;
+				const auto reach = ax * block.m_extents[0][lane] + ay * block.m_extents[1][lane] +
+								   az * block.m_extents[2][lane] + block.m_radii[lane];
+
+				inside[lane] &= static_cast<std::uint32_t>(signed_distance + reach >= 0.0f);
+			}
+		}
+
+		for (auto lane = std::size_t {}; lane < lanes; lane++)
+		{
+			visible[visible_count] = first_index + static_cast<std::uint32_t>(lane);
+			visible_count += inside[lane];
+		}
+
+		return visible_count;
+	}
+
+	// fills blocks of volumes through the loader, function(volume_block&, index, lane), and culls them
+	template <typename F>
+	auto cull_volumes(const lh::geometry::frustum& frustum,
+					  const std::size_t count,
+					  std::span<std::uint32_t> visible,
+					  const F& load) -> std::size_t
+	{
+		if (visible.size() < count)
+		{
+			lh::output::error() << "the visible span can not hold the indices of every culled volume";
+			return 0;
+		}
+
+		const auto planes = frustum_planes {frustum};
+
+		auto visible_count = std::size_t {};
+		auto block = volume_block {};
+
+		for (auto first = std::size_t {}; first < count; first += lane_count)
+		{
+			const auto lanes = std::min(lane_count, count - first);
+
+			for (auto lane = std::size_t {}; lane < lanes; lane++)
+				load(block, first + lane, lane);
+
+			visible_count =
+				cull_block(planes, block, static_cast<std::uint32_t>(first), lanes, visible, visible_count);
+		}
+
+		return visible_count;
+	}
+}
+
+namespace lh
+{
+	namespace geometry
+	{
+		frustum::frustum() : m_planes {} {}
+
+		frustum::frustum(const transformation_t& view_projection) : m_planes {}
+		{
+			// rows of the transformation, glm matrices are indexed by column first
+			const auto row = [&view_projection](const std::size_t index) {
+				return vec4_t {view_projection[0][index],
+							   view_projection[1][index],
+							   view_projection[2][index],
+							   view_projection[3][index]};
+			};
+
+			const auto planes = std::array {row(3) + row(0),
+											row(3) - row(0),
+											row(3) + row(1),
+											row(3) - row(1),
+											row(2),
+											row(3) - row(2)};
+
+			for (auto i = std::size_t {}; i < planes.size(); i++)
+			{
+				const auto normal = normal_t {planes[i].x, planes[i].y, planes[i].z};
+				const auto length = glm::length(normal);
+
+				m_planes[i] = {normal / length, planes[i].w / length};
+			}
+		}
+
+		auto frustum::contains(const position_t& position) const -> bool
+		{
+			return std::ranges::all_of(m_planes, [&position](const geometry::plane& plane) {
+				return glm::dot(plane.m_normal, position) + plane.m_distance >= 0.0f;
+			});
+		}
+
+		auto frustum::intersects(const sphere& sphere) const -> bool
+		{
+			return std::ranges::all_of(m_planes, [&sphere](const geometry::plane& plane) {
+				return glm::dot(plane.m_normal, sphere.m_position) + plane.m_distance >= -sphere.m_radius;
+			});
+		}
+
+		auto frustum::intersects(const aabb& aabb) const -> bool
+		{
+			const auto center = aabb.center();
+			const auto extents = aabb.size() * 0.5f;
+
+			return std::ranges::all_of(m_planes, [&center, &extents](const geometry::plane& plane) {
+				return glm::dot(plane.m_normal, center) + plane.m_distance >=
+					   -glm::dot(glm::abs(plane.m_normal), extents);
+			});
+		}
+
+		auto frustum::plane(const side side) const -> const geometry::plane&
+		{
+			return m_planes[std::to_underlying(side)];
+		}
+
+		auto cull(const frustum& frustum, std::span<const sphere> spheres, std::span<std::uint32_t> visible)
+			-> std::size_t
+		{
+			const auto load = [&spheres](volume_block& block, const std::size_t index, const std::size_t lane) {
+				const auto& sphere = spheres[index];
+
+				for (auto axis = 0; axis < 3; axis++)
+				{
+					block.m_centers[axis][lane] = sphere.m_position[axis];
+					block.m_extents[axis][lane] = 0.0f;
+				}
+
+				block.m_radii[lane] = sphere.m_radius;
+			};
+
+			return cull_volumes(frustum, spheres.size(), visible, load);
+		}
+
+		auto cull(const frustum& frustum, std::span<const aabb> aabbs, std::span<std::uint32_t> visible) -> std::size_t
+		{
+			const auto load = [&aabbs](volume_block& block, const std::size_t index, const std::size_t lane) {
+				const auto& aabb = aabbs[index];
+
+				for (auto axis = 0; axis < 3; axis++)
+				{
+					block.m_centers[axis][lane] = (aabb.m_minima[axis] + aabb.m_maxima[axis]) * 0.5f;
+					block.m_extents[axis][lane] = (aabb.m_maxima[axis] - aabb.m_minima[axis]) * 0.5f;
+				}
+
+				block.m_radii[lane] = 0.0f;
+			};
+
+			return cull_volumes(frustum, aabbs.size(), visible, load);
+		}
+
+		auto cull(const frustum& frustum,
+				  const aabb& mesh_bounds,
+				  std::span<const transformation_t> instances,
+				  std::span<std::uint32_t> visible) -> std::size_t
+		{
+			const auto center = mesh_bounds.center();
+			const auto extents = mesh_bounds.size() * 0.5f;
+
+			// the transformed box is enclosed by the box around the transformed center,
+			// reaching as far along each axis as the absolute linear part carries the extents
+			const auto load = [&](volume_block& block, const std::size_t index, const std::size_t lane) {
+				const auto& instance = instances[index];
+
+				for (auto axis = 0; axis < 3; axis++)
+				{
+					block.m_centers[axis][lane] = instance[0][axis] * center.x + instance[1][axis] * center.y +
+												  instance[2][axis] * center.z + instance[3][axis];
+					block.m_extents[axis][lane] = std::abs(instance[0][axis]) * extents.x +
+												  std::abs(instance[1][axis]) * extents.y +
+												  std::abs(instance[2][axis]) * extents.z;
+				}
+
+				block.m_radii[lane] = 0.0f;
+			};
+
+			return cull_volumes(frustum, instances.size(), visible, load);
+		}
+	}
+}
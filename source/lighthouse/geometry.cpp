@@ -138,5 +138,45 @@ namespace lh
 					0.0f,
 					1.0f};
 		}
+
+		auto compose_transformation(const position_t& position, const quaternion_t& rotation, const scale_t& scale)
+			-> const transformation_t
+		{
+			auto transformation = transformation_t {};
+
+			compose_transformations({&position, 1}, {&rotation, 1}, {&scale, 1}, {&transformation, 1});
+
+			return transformation;
+		}
+
+		auto compose_transformations(std::span<const position_t> positions,
+									 std::span<const quaternion_t> rotations,
+									 std::span<const scale_t> scales,
+									 std::span<transformation_t> transformations) -> void
+		{
+			// scaling multiplies the rows of the rotation, translation ends up rotated and scaled in the last column
+			for (auto i = std::size_t {}; i < transformations.size(); i++)
+			{
+				const auto& p = positions[i];
+				const auto& q = rotations[i];
+				const auto& s = scales[i];
+
+				const auto xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+				const auto xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+				const auto wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+				const auto c0 = vec3_t {1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy)} * s;
+				const auto c1 = vec3_t {2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx)} * s;
+				const auto c2 = vec3_t {2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy)} * s;
+				const auto c3 = c0 * p.x + c1 * p.y + c2 * p.z;
+
+				auto& transformation = transformations[i];
+
+				transformation[0] = vec4_t {c0, 0.0f};
+				transformation[1] = vec4_t {c1, 0.0f};
+				transformation[2] = vec4_t {c2, 0.0f};
+				transformation[3] = vec4_t {c3, 1.0f};
+			}
+		}
 	}
 }
@@ -0,0 +1,132 @@
+module;
+
+module job_system;
+
+namespace lh
+{
+	auto job_system::counter::done() const -> bool
+	{
+		return m_pending_jobs.load(std::memory_order_acquire) == 0;
+	}
+
+	job_system::job_system(const create_info& create_info)
+		: m_queues {}, m_queued_jobs {}, m_sleep_mutex {}, m_wake_condition {}, m_threads {}
+	{
+		for (auto i = std::size_t {}; i < create_info.m_thread_count + 1; i++)
+			m_queues.emplace_back(std::make_unique<job_queue>());
+
+		m_threads.reserve(create_info.m_thread_count);
+
+		for (auto i = std::size_t {}; i < create_info.m_thread_count; i++)
+			m_threads.emplace_back([this, i](std::stop_token stop_token) { work(stop_token, i); });
+	}
+
+	job_system::~job_system()
+	{
+		for (auto& thread : m_threads)
+			thread.request_stop();
+
+		m_wake_condition.notify_all();
+		m_threads.clear();
+	}
+
+	auto job_system::submit(job_t function, counter& counter) -> void
+	{
+		counter.m_pending_jobs.fetch_add(1, std::memory_order_relaxed);
+
+		auto& queue = *m_queues[current_queue_index()];
+
+		{
+			auto lock = std::scoped_lock {queue.m_mutex};
+			queue.m_jobs.emplace_back(std::move(function), &counter);
+		}
+
+		{
+			// taking the sleep lock prevents the wake up from slipping in between a workers check and its wait
+			auto lock = std::scoped_lock {m_sleep_mutex};
+			m_queued_jobs.fetch_add(1, std::memory_order_release);
+		}
+
+		m_wake_condition.notify_one();
+	}
+
+	auto job_system::wait(counter& counter) -> void
+	{
+		const auto queue_index = current_queue_index();
+
+		while (not counter.done())
+			if (not try_execute(queue_index)) std::this_thread::yield();
+	}
+
+	auto job_system::thread_count() const -> const std::size_t
+	{
+		return m_threads.size();
+	}
+
+	auto job_system::work(std::stop_token stop_token, const std::size_t queue_index) -> void
+	{
+		s_worker_owner = this;
+		s_worker_queue_index = queue_index;
+
+		while (not stop_token.stop_requested())
+		{
+			if (try_execute(queue_index)) continue;
+
+			auto lock = std::unique_lock {m_sleep_mutex};
+
+			m_wake_condition.wait(lock, stop_token, [this]() {
+				return m_queued_jobs.load(std::memory_order_acquire) != 0;
+			});
+		}
+
+		s_worker_owner = nullptr;
+	}
+
+	auto job_system::try_execute(const std::size_t queue_index) -> bool
+	{
+		auto job = std::optional<job_system::job> {};
+
+		{
+			auto& queue = *m_queues[queue_index];
+			auto lock = std::scoped_lock {queue.m_mutex};
+
+			if (not queue.m_jobs.empty())
+			{
+				job = std::move(queue.m_jobs.back());
+				queue.m_jobs.pop_back();
+			}
+		}
+
+		// steal the oldest jobs, they tend to be the largest ones
+		for (auto i = std::size_t {1}; not job and i < m_queues.size(); i++)
+		{
+			auto& queue = *m_queues[(queue_index + i) % m_queues.size()];
+			auto lock = std::scoped_lock {queue.m_mutex};
+
+			if (not queue.m_jobs.empty())
+			{
+				job = std::move(queue.m_jobs.front());
+				queue.m_jobs.pop_front();
+			}
+		}
+
+		if (not job) return false;
+
+		m_queued_jobs.fetch_sub(1, std::memory_order_relaxed);
+		execute(*job);
+
+		return true;
+	}
+
+	auto job_system::execute(job& job) -> void
+	{
+		std::invoke(job.m_function);
+
+		job.m_counter->m_pending_jobs.fetch_sub(1, std::memory_order_release);
+	}
+
+	auto job_system::current_queue_index() const -> std::size_t
+	{
+		return s_worker_owner == this ? s_worker_queue_index : m_queues.size() - 1;
+	}
+}
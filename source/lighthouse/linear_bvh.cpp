@@ -0,0 +1,392 @@
+module;
+
+module linear_bvh;
+
+import output;
+
+namespace
+{
+	// spreads the lowest 10 bits apart, leaving two zero bits after each of them
+	auto spread_10(std::uint64_t value) -> std::uint64_t
+	{
+		value &= 0x3ff;
+		value = (value | value << 16) & 0x30000ff;
+		value = (value | value << 8) & 0x300f00f;
+		value = (value | value << 4) & 0x30c30c3;
+		value = (value | value << 2) & 0x9249249;
+
+		return value;
+	}
+
+	// spreads the lowest 21 bits apart, leaving two zero bits after each of them
+	auto spread_21(std::uint64_t value) -> std::uint64_t
+	{
+		value &= 0x1fffff;
+		value = (value | value << 32) & 0x1f00000000ffff;
+		value = (value | value << 16) & 0x1f0000ff0000ff;
+		value = (value | value << 8) & 0x100f00f00f00f00f;
+		value = (value | value << 4) & 0x10c30c30c30c30c3;
+		value = (value | value << 2) & 0x1249249249249249;
+
+		return value;
+	}
+}
+
+namespace lh
+{
+	namespace geometry
+	{
+		linear_bvh::linear_bvh(const create_info& create_info)
+			: m_create_info {create_info},
+			  m_nodes {},
+			  m_parents {},
+			  m_root {},
+			  m_prefixes {},
+			  m_centers {},
+			  m_codes {},
+			  m_indices {},
+			  m_sorted_codes {},
+			  m_sorted_indices {},
+			  m_block_digits {},
+			  m_visits {}
+		{
+			m_create_info.m_grain = std::max(m_create_info.m_grain, std::size_t {1});
+		}
+
+		auto linear_bvh::build(std::span<const aabb> bounds, job_system& job_system) -> void
+		{
+			// node indices need to fit into 32 bits, with the largest one marking leaves
+			if (bounds.size() > std::numeric_limits<std::uint32_t>::max() / 2)
+			{
+				output::error() << "linear bvh can not hold more than " << std::numeric_limits<std::uint32_t>::max() / 2
+								<< " objects";
+				return;
+			}
+
+			const auto count = bounds.size();
+
+			m_nodes.resize(count == 0 ? 0 : 2 * count - 1);
+			m_parents.resize(m_nodes.size());
+			m_prefixes.resize(count + 1);
+			m_centers.resize(count);
+			m_codes.resize(count);
+			m_indices.resize(packed_indices() ? 0 : count);
+			m_sorted_codes.resize(count);
+			m_sorted_indices.resize(m_indices.size());
+			m_block_digits.resize(block_count());
+
+			// atomics can not be moved, so they are replaced rather than resized
+			if (m_visits.size() < count) m_visits = std::vector<std::atomic<std::uint32_t>>(count);
+
+			if (count == 0) return;
+
+			compute_codes(bounds, job_system);
+			sort_codes(job_system);
+			link_nodes(bounds, job_system);
+		}
+
+		auto linear_bvh::refit(std::span<const aabb> bounds, job_system& job_system) -> void
+		{
+			if (bounds.size() != size())
+			{
+				output::error() << "linear bvh was built with " << size() << " objects, but is refit with "
+								<< bounds.size();
+				return;
+			}
+
+			if (bounds.empty()) return;
+
+			refit_nodes(bounds, job_system);
+		}
+
+		auto linear_bvh::bounds() const -> const aabb&
+		{
+			static const auto no_bounds = aabb {};
+
+			return m_nodes.empty() ? no_bounds : m_nodes[m_root].m_bounds;
+		}
+
+		auto linear_bvh::nodes() const -> std::span<const node>
+		{
+			return m_nodes;
+		}
+
+		auto linear_bvh::root() const -> const std::uint32_t
+		{
+			return m_root;
+		}
+
+		auto linear_bvh::size() const -> const std::size_t
+		{
+			return m_codes.size();
+		}
+
+		auto linear_bvh::compute_codes(std::span<const aabb> bounds, job_system& job_system) -> void
+		{
+			const auto count = bounds.size();
+			const auto grain = m_create_info.m_grain;
+
+			// codes cover the bounds of the centers, gathered per block first, the centers are kept for quantizing them
+			auto block_bounds = std::vector<aabb>(block_count(), empty_bounds());
+
+			job_system.parallel_for(block_bounds.size(), 1, [&](const std::size_t first, const std::size_t last) {
+				for (auto block = first; block < last; block++)
+				{
+					auto centers = empty_bounds();
+
+					for (auto i = block * grain; i < std::min(block * grain + grain, count); i++)
+					{
+						m_centers[i] = bounds[i].center();
+						centers = merge(centers, m_centers[i]);
+					}
+
+					block_bounds[block] = centers;
+				}
+			});
+
+			const auto merge_bounds = [](const aabb& first, const aabb& second) { return merge(first, second); };
+			const auto center_bounds =
+				std::accumulate(block_bounds.begin(), block_bounds.end(), empty_bounds(), merge_bounds);
+
+			const auto high_precision = m_create_info.m_precision == precision::high;
+			const auto cell_limit = high_precision ? scalar_t {(1 << 21) - 1} : scalar_t {(1 << 10) - 1};
+			const auto extent = center_bounds.m_maxima - center_bounds.m_minima;
+			// flat axes map every center to the first cell
+			const auto scale = vec3_t {extent.x > 0.0f ? cell_limit / extent.x : 0.0f,
+									   extent.y > 0.0f ? cell_limit / extent.y : 0.0f,
+									   extent.z > 0.0f ? cell_limit / extent.z : 0.0f};
+
+			job_system.parallel_for(count, grain, [&](const std::size_t first, const std::size_t last) {
+				for (auto i = first; i < last; i++)
+				{
+					const auto cell =
+						glm::clamp((m_centers[i] - center_bounds.m_minima) * scale, vec3_t {0.0f}, vec3_t {cell_limit});
+					const auto x = static_cast<std::uint64_t>(cell.x);
+					const auto y = static_cast<std::uint64_t>(cell.y);
+					const auto z = static_cast<std::uint64_t>(cell.z);
+
+					if (high_precision)
+					{
+						m_codes[i] = spread_21(x) << 2 | spread_21(y) << 1 | spread_21(z);
+						m_indices[i] = static_cast<std::uint32_t>(i);
+					}
+					else
+						m_codes[i] = (spread_10(x) << 2 | spread_10(y) << 1 | spread_10(z)) << 32 | i;
+				}
+			});
+		}
+
+		auto linear_bvh::sort_codes(job_system& job_system) -> void
+		{
+			const auto count = size();
+			const auto grain = m_create_info.m_grain;
+			const auto packed = packed_indices();
+			// packed codes are already ordered by their index, which follows the order of the objects
+			const auto first_bit = packed ? std::size_t {32} : std::size_t {};
+			const auto last_bit = packed ? std::size_t {62} : std::size_t {63};
+
+			const auto for_each_block = [&](const auto& function) {
+				job_system.parallel_for(m_block_digits.size(), 1, [&](const std::size_t first, const std::size_t last) {
+					for (auto block = first; block < last; block++)
+						function(block, block * grain, std::min(block * grain + grain, count));
+				});
+			};
+
+			// least significant digit first, each pass is stable and keeps the order of the previous ones
+			for (auto shift = first_bit; shift < last_bit; shift += s_radix_bits)
+			{
+				const auto digit_of = [shift](const code_t code) { return code >> shift & (s_radix_size - 1); };
+
+				for_each_block([&](const std::size_t block, const std::size_t first, const std::size_t last) {
+					auto digits = std::array<std::uint32_t, s_radix_size> {};
+
+					for (const auto code : std::span {m_codes}.subspan(first, last - first))
+						digits[digit_of(code)]++;
+
+					m_block_digits[block] = digits;
+				});
+
+				// the digits of each block are scattered behind those of lower digits, and of preceding blocks
+				// blocks are visited in order, with a running offset for every digit, rather than striding across them
+				auto offsets = std::array<std::uint32_t, s_radix_size> {};
+
+				for (const auto& digits : m_block_digits)
+					for (auto digit = std::size_t {}; digit < s_radix_size; digit++)
+						offsets[digit] += digits[digit];
+
+				// codes sharing the digit are already in order
+				if (std::ranges::contains(offsets, count)) continue;
+
+				std::exclusive_scan(offsets.begin(), offsets.end(), offsets.begin(), std::uint32_t {});
+
+				for (auto& digits : m_block_digits)
+					for (auto digit = std::size_t {}; digit < s_radix_size; digit++)
+						offsets[digit] += std::exchange(digits[digit], offsets[digit]);
+
+				for_each_block([&](const std::size_t block, const std::size_t first, const std::size_t last) {
+					// copied, so that the compiler can keep them apart from the sorted codes
+					auto offsets = m_block_digits[block];
+
+					const auto codes = m_codes.data();
+					const auto sorted_codes = m_sorted_codes.data();
+
+					if (packed)
+					{
+						for (auto i = first; i < last; i++)
+							sorted_codes[offsets[digit_of(codes[i])]++] = codes[i];
+
+						return;
+					}
+
+					const auto indices = m_indices.data();
+					const auto sorted_indices = m_sorted_indices.data();
+
+					for (auto i = first; i < last; i++)
+					{
+						const auto target = offsets[digit_of(codes[i])]++;
+
+						sorted_codes[target] = codes[i];
+						sorted_indices[target] = indices[i];
+					}
+				});
+
+				std::swap(m_codes, m_sorted_codes);
+				std::swap(m_indices, m_sorted_indices);
+			}
+		}
+
+		auto linear_bvh::link_nodes(std::span<const aabb> bounds, job_system& job_system) -> void
+		{
+			const auto count = static_cast<std::uint32_t>(size());
+			const auto grain = m_create_info.m_grain;
+			const auto first_leaf = count - 1;
+
+			// leaves are written apart from the walk below, so that fetching their scattered bounds is not held up by
+			// the atomic exchanges of the walk
+			m_prefixes.front() = 0;
+			m_prefixes.back() = 0;
+
+			const auto packed = packed_indices();
+
+			job_system.parallel_for(count, grain, [&](const std::size_t first, const std::size_t last) {
+				for (auto i = first; i < last; i++)
+				{
+					const auto index = packed ? static_cast<std::uint32_t>(m_codes[i]) : m_indices[i];
+
+					m_nodes[first_leaf + i] = {bounds[index], s_leaf, index};
+
+					if (i == 0) continue;
+
+					m_prefixes[i] = static_cast<std::uint8_t>(common_prefix(i - 1, i) + 1);
+					m_visits[i - 1].store(s_leaf, std::memory_order_relaxed);
+				}
+			});
+
+			// every leaf walks up the hierarchy, growing the range of sorted objects covered by its node
+			// a range joins the neighbouring range it shares the longer prefix with, below the interior node splitting
+			// both of them, the first child to arrive there leaves its end of the range for the second one and stops
+			job_system.parallel_for(count, grain, [&](const std::size_t first, const std::size_t last) {
+				for (auto i = static_cast<std::uint32_t>(first); i < last; i++)
+				{
+					auto node = first_leaf + i;
+					auto node_bounds = m_nodes[node].m_bounds;
+					auto range_first = i;
+					auto range_last = i;
+
+					// the ends of the codes share no prefix with anything, so the root is the only node not joining
+					while (range_first != 0 or range_last != first_leaf)
+					{
+						const auto join_right = m_prefixes[range_last + 1] > m_prefixes[range_first];
+						const auto parent = join_right ? range_last : range_first - 1;
+
+						m_parents[node] = parent;
+						(join_right ? m_nodes[parent].m_left : m_nodes[parent].m_right) = node;
+
+						// the node of the child that got here first is visible to the second one
+						const auto other_end =
+							m_visits[parent].exchange(join_right ? range_first : range_last, std::memory_order_acq_rel);
+
+						if (other_end == s_leaf) break;
+
+						(join_right ? range_last : range_first) = other_end;
+
+						const auto sibling = join_right ? m_nodes[parent].m_right : m_nodes[parent].m_left;
+
+						node_bounds = merge(node_bounds, m_nodes[sibling].m_bounds);
+						m_nodes[parent].m_bounds = node_bounds;
+						node = parent;
+					}
+
+					if (range_first == 0 and range_last == first_leaf)
+					{
+						m_root = node;
+						m_parents[node] = node;
+					}
+				}
+			});
+		}
+
+		auto linear_bvh::refit_nodes(std::span<const aabb> bounds, job_system& job_system) -> void
+		{
+			const auto count = size();
+			const auto grain = m_create_info.m_grain;
+			const auto first_leaf = count - 1;
+
+			// as when building, leaves fetch their bounds apart from the walk
+			job_system.parallel_for(count, grain, [&](const std::size_t first, const std::size_t last) {
+				for (auto i = first; i < last; i++)
+				{
+					m_nodes[first_leaf + i].m_bounds = bounds[m_nodes[first_leaf + i].m_right];
+
+					if (i != 0) m_visits[i - 1].store(0, std::memory_order_relaxed);
+				}
+			});
+
+			// every leaf walks up the hierarchy, interior nodes are merged once both of their children are done
+			job_system.parallel_for(count, grain, [&](const std::size_t first, const std::size_t last) {
+				for (auto leaf = first_leaf + first; leaf < first_leaf + last; leaf++)
+				{
+					auto node = static_cast<std::uint32_t>(leaf);
+					auto node_bounds = m_nodes[node].m_bounds;
+
+					while (node != m_root)
+					{
+						const auto parent = m_parents[node];
+
+						// the bounds of the child that got here first are visible to the second one
+						if (m_visits[parent].fetch_add(1, std::memory_order_acq_rel) == 0) break;
+
+						const auto& children = m_nodes[parent];
+						const auto sibling = children.m_left == node ? children.m_right : children.m_left;
+
+						node_bounds = merge(node_bounds, m_nodes[sibling].m_bounds);
+						m_nodes[parent].m_bounds = node_bounds;
+						node = parent;
+					}
+				}
+			});
+		}
+
+		auto linear_bvh::common_prefix(const std::size_t first, const std::size_t second) const -> std::int32_t
+		{
+			const auto first_code = m_codes[first];
+			const auto second_code = m_codes[second];
+
+			// packed codes differ in their indices at the latest
+			if (first_code == second_code)
+				return 64 + std::countl_zero(static_cast<std::uint32_t>(first) ^ static_cast<std::uint32_t>(second));
+
+			return std::countl_zero(first_code ^ second_code);
+		}
+
+		auto linear_bvh::packed_indices() const -> bool
+		{
+			return m_create_info.m_precision == precision::low;
+		}
+
+		auto linear_bvh::block_count() const -> std::size_t
+		{
+			return (m_codes.size() + m_create_info.m_grain - 1) / m_create_info.m_grain;
+		}
+	}
+}
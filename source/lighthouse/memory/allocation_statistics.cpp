@@ -0,0 +1,41 @@
+module;
+
+module memory_allocation_statistics;
+
+namespace lh
+{
+	auto allocation_statistics::fragmentation() const -> const float01_t
+	{
+		if (m_free_bytes == 0) return 0.0f;
+
+		return 1.0f - static_cast<float01_t>(m_largest_free_block_bytes) / static_cast<float01_t>(m_free_bytes);
+	}
+
+	auto allocation_counters::record_allocation(const std::size_t size, const std::size_t used_bytes) -> void
+	{
+		m_total_allocation_count++;
+		m_peak_used_bytes = std::max(m_peak_used_bytes, used_bytes);
+
+		const auto bucket = static_cast<std::size_t>(std::bit_width(std::max(size, std::size_t {1})) - 1);
+		m_allocation_size_histogram[bucket]++;
+	}
+
+	auto allocation_counters::record_free(const std::size_t count) -> void
+	{
+		m_total_free_count += count;
+	}
+
+	auto allocation_counters::allocation_count() const -> const std::size_t
+	{
+		return m_total_allocation_count - m_total_free_count;
+	}
+
+	auto allocation_counters::fill(allocation_statistics& statistics) const -> void
+	{
+		statistics.m_peak_used_bytes = m_peak_used_bytes;
+		statistics.m_allocation_count = allocation_count();
+		statistics.m_total_allocation_count = m_total_allocation_count;
+		statistics.m_total_free_count = m_total_free_count;
+		statistics.m_allocation_size_histogram = m_allocation_size_histogram;
+	}
+}
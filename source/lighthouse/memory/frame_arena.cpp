@@ -0,0 +1,161 @@
+module;
+
+module memory_frame_arena;
+
+import output;
+
+namespace lh
+{
+	frame_arena::frame_arena(const std::size_t size)
+		: m_memory {static_cast<std::byte*>(std::malloc(size))},
+		  m_size {size},
+		  m_offset {},
+		  m_peak_bytes {},
+		  m_overflow_blocks {},
+		  m_overflow_bytes {},
+		  m_allocation_counters {}
+	{
+		// without memory every request is served from overflow blocks, until the arena is grown on reset
+		if (not m_memory)
+		{
+			output::error() << "could not allocate: " << size << " bytes for frame arena";
+			m_size = 0;
+		}
+	}
+
+	frame_arena::frame_arena(frame_arena&& other) noexcept
+		: m_memory {std::exchange(other.m_memory, nullptr)},
+		  m_size {std::exchange(other.m_size, {})},
+		  m_offset {std::exchange(other.m_offset, {})},
+		  m_peak_bytes {std::exchange(other.m_peak_bytes, {})},
+		  m_overflow_blocks {std::exchange(other.m_overflow_blocks, {})},
+		  m_overflow_bytes {std::exchange(other.m_overflow_bytes, {})},
+		  m_allocation_counters {std::exchange(other.m_allocation_counters, {})}
+	{}
+
+	auto frame_arena::operator=(frame_arena&& other) noexcept -> frame_arena&
+	{
+		release_overflow_blocks();
+		if (m_memory) std::free(m_memory);
+
+		m_memory = std::exchange(other.m_memory, nullptr);
+		m_size = std::exchange(other.m_size, {});
+		m_offset = std::exchange(other.m_offset, {});
+		m_peak_bytes = std::exchange(other.m_peak_bytes, {});
+		m_overflow_blocks = std::exchange(other.m_overflow_blocks, {});
+		m_overflow_bytes = std::exchange(other.m_overflow_bytes, {});
+		m_allocation_counters = std::exchange(other.m_allocation_counters, {});
+
+		return *this;
+	}
+
+	frame_arena::~frame_arena()
+	{
+		release_overflow_blocks();
+
+		if (m_memory) std::free(m_memory);
+	}
+
+	auto frame_arena::request_and_commit_suballocation(const std::size_t size, const std::size_t alignment) -> void*
+	{
+		const auto address = reinterpret_cast<std::uintptr_t>(m_memory) + m_offset;
+		const auto padding = ((address + alignment - 1) & ~(alignment - 1)) - address;
+
+		if (m_offset + padding + size <= m_size) [[likely]]
+		{
+			const auto result = m_memory + m_offset + padding;
+
+			m_offset += padding + size;
+			m_peak_bytes = std::max(m_peak_bytes, m_offset);
+			m_allocation_counters.record_allocation(size, used_memory_bytes());
+
+			return result;
+		}
+
+		// arena ran dry, serve the request from an overflow block
+		const auto overflow_block = std::malloc(size + alignment);
+
+		if (not overflow_block)
+		{
+			output::error() << "could not allocate: " << size << " bytes for frame arena overflow";
+			return nullptr;
+		}
+
+		if (m_overflow_blocks.empty())
+			output::warning() << "frame arena of: " << m_size << " bytes ran dry, it will be grown on reset";
+
+		m_overflow_blocks.push_back(overflow_block);
+		m_overflow_bytes += size + alignment;
+		m_peak_bytes = std::max(m_peak_bytes, m_offset + m_overflow_bytes);
+		m_allocation_counters.record_allocation(size, used_memory_bytes());
+
+		const auto overflow_address = reinterpret_cast<std::uintptr_t>(overflow_block);
+
+		return reinterpret_cast<void*>((overflow_address + alignment - 1) & ~(alignment - 1));
+	}
+
+	auto frame_arena::free_suballocation(const memory_block&) -> void {}
+
+	auto frame_arena::reset() -> void
+	{
+		m_offset = 0;
+		// every suballocation is released at once
+		m_allocation_counters.record_free(m_allocation_counters.allocation_count());
+
+		if (m_overflow_blocks.empty()) [[likely]]
+			return;
+
+		// grow the arena to the high-water mark, so that the demand of the last frame fits without overflowing
+		const auto required_size = std::bit_ceil(m_peak_bytes);
+
+		release_overflow_blocks();
+
+		if (const auto memory = static_cast<std::byte*>(std::malloc(required_size)))
+		{
+			std::free(m_memory);
+
+			m_memory = memory;
+			m_size = required_size;
+		}
+		else
+			output::warning() << "could not grow frame arena to: " << required_size << " bytes";
+	}
+
+	auto frame_arena::size() const -> const std::size_t
+	{
+		return m_size;
+	}
+
+	auto frame_arena::used_memory_bytes() const -> const std::size_t
+	{
+		return m_offset + m_overflow_bytes;
+	}
+
+	auto frame_arena::peak_memory_bytes() const -> const std::size_t
+	{
+		return m_peak_bytes;
+	}
+
+	auto frame_arena::statistics() const -> const allocation_statistics
+	{
+		const auto free_bytes = m_size - m_offset;
+		auto statistics = allocation_statistics {.m_reserved_bytes = m_size + m_overflow_bytes,
+												 .m_used_bytes = used_memory_bytes(),
+												 .m_free_bytes = free_bytes,
+												 .m_largest_free_block_bytes = free_bytes,
+												 .m_free_block_count = free_bytes > 0 ? std::size_t {1} : std::size_t {}};
+
+		m_allocation_counters.fill(statistics);
+
+		return statistics;
+	}
+
+	auto frame_arena::release_overflow_blocks() -> void
+	{
+		for (const auto overflow_block : m_overflow_blocks)
+			std::free(overflow_block);
+
+		m_overflow_blocks.clear();
+		m_overflow_bytes = 0;
+	}
+}
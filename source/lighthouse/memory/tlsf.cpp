@@ -0,0 +1,303 @@
+module;
+
+module memory_tlsf;
+
+namespace lh
+{
+	two_level_segregated_fit::two_level_segregated_fit(const std::size_t size,
+													   const initial_block_count_t initial_block_count,
+													   const std::uintptr_t base_address)
+		: m_blocks {},
+		  m_recycled_blocks {},
+		  m_used_blocks {},
+		  m_first_level_bitmap {},
+		  m_second_level_bitmaps {},
+		  m_free_lists {},
+		  m_base_address {base_address},
+		  m_free_memory_bytes {},
+		  m_total_alignment_padding_bytes {},
+		  m_free_block_count {}
+	{
+		for (auto& free_list : m_free_lists)
+			free_list.fill(s_null_block);
+
+		if (initial_block_count > 0)
+		{
+			m_blocks.reserve(initial_block_count);
+			m_used_blocks.reserve(initial_block_count);
+		}
+
+		if (size == 0) return;
+
+		insert_free_block(create_block(0, size));
+		m_free_memory_bytes = size;
+	}
+
+	auto two_level_segregated_fit::request_and_commit_suballocation(const std::size_t size, const std::size_t alignment)
+		-> const offset_t
+	{
+		if (size == 0 or std::max(size, alignment) > std::numeric_limits<std::size_t>::max() / 4) [[unlikely]]
+			return invalid_offset;
+
+		// round the requested size up to granularity
+		const auto block_size = (size + s_granularity - 1) & ~(s_granularity - 1);
+		// offsets are multiples of the granularity, so only larger alignments, or a base address not aligned to the
+		// requested alignment, require padding, any block of the searched size is able to hold the padding as well
+		const auto requires_padding = alignment > s_granularity or (m_base_address & (alignment - 1)) != 0;
+		const auto search_size = requires_padding ? block_size + alignment - 1 : block_size;
+		const auto index = find_suitable_block(mapping_search(search_size));
+
+		if (index == s_null_block) return invalid_offset;
+
+		remove_free_block(index);
+
+		// split off the alignment padding and return it to the free lists
+		const auto block_address = m_base_address + m_blocks[index].m_offset;
+		const auto padding = ((block_address + alignment - 1) & ~(alignment - 1)) - block_address;
+
+		if (padding > 0)
+		{
+			split_front(index, padding);
+			m_total_alignment_padding_bytes += padding;
+		}
+
+		// split off the remainder of the claimed block and return it to the free lists
+		if (m_blocks[index].m_size - block_size >= s_granularity) split_back(index, block_size);
+
+		auto& claimed = m_blocks[index];
+		claimed.m_free = false;
+		m_free_memory_bytes -= claimed.m_size;
+		m_used_blocks.insert(claimed.m_offset, index);
+
+		return claimed.m_offset;
+	}
+
+	auto two_level_segregated_fit::free_suballocation(const offset_t offset) -> const std::size_t
+	{
+		const auto used_block = m_used_blocks.extract(offset);
+
+		if (not used_block) [[unlikely]]
+			return 0;
+
+		auto index = *used_block;
+
+		const auto released_size = m_blocks[index].m_size;
+		m_blocks[index].m_free = true;
+		m_free_memory_bytes += released_size;
+
+		// merge with the physically preceding free block
+		if (const auto previous = m_blocks[index].m_previous_physical;
+			previous != s_null_block and m_blocks[previous].m_free)
+		{
+			remove_free_block(previous);
+
+			m_blocks[previous].m_size += m_blocks[index].m_size;
+			m_blocks[previous].m_next_physical = m_blocks[index].m_next_physical;
+
+			if (m_blocks[index].m_next_physical != s_null_block)
+				m_blocks[m_blocks[index].m_next_physical].m_previous_physical = previous;
+
+			recycle_block(index);
+			index = previous;
+		}
+
+		// merge with the physically succeeding free block
+		if (const auto next = m_blocks[index].m_next_physical; next != s_null_block and m_blocks[next].m_free)
+		{
+			remove_free_block(next);
+
+			m_blocks[index].m_size += m_blocks[next].m_size;
+			m_blocks[index].m_next_physical = m_blocks[next].m_next_physical;
+
+			if (m_blocks[next].m_next_physical != s_null_block)
+				m_blocks[m_blocks[next].m_next_physical].m_previous_physical = index;
+
+			recycle_block(next);
+		}
+
+		insert_free_block(index);
+
+		return released_size;
+	}
+
+	auto two_level_segregated_fit::free_memory_bytes() const -> const std::size_t
+	{
+		return m_free_memory_bytes;
+	}
+
+	auto two_level_segregated_fit::total_alignment_padding_bytes() const -> const std::size_t
+	{
+		return m_total_alignment_padding_bytes;
+	}
+
+	auto two_level_segregated_fit::free_block_count() const -> const std::size_t
+	{
+		return m_free_block_count;
+	}
+
+	auto two_level_segregated_fit::largest_free_block_bytes() const -> const std::size_t
+	{
+		if (not m_first_level_bitmap) return 0;
+
+		const auto first_level = static_cast<std::size_t>(std::bit_width(m_first_level_bitmap) - 1);
+		const auto second_level = static_cast<std::size_t>(std::bit_width(m_second_level_bitmaps[first_level]) - 1);
+
+		auto result = std::size_t {};
+
+		for (auto index = m_free_lists[first_level][second_level]; index != s_null_block;
+			 index = m_blocks[index].m_next_free)
+			result = std::max(result, m_blocks[index].m_size);
+
+		return result;
+	}
+
+	auto two_level_segregated_fit::mapping_insert(const std::size_t size) -> const mapping
+	{
+		if (size < s_small_block_size) return {0, size >> s_granularity_log2};
+
+		const auto most_significant_bit = static_cast<std::size_t>(std::bit_width(size) - 1);
+
+		return {most_significant_bit - (s_first_level_shift - 1),
+				(size >> (most_significant_bit - s_second_level_count_log2)) ^ s_second_level_count};
+	}
+
+	auto two_level_segregated_fit::mapping_search(const std::size_t size) -> const mapping
+	{
+		// small classes span granularity sized ranges
+		if (size < s_small_block_size) return mapping_insert((size + s_granularity - 1) & ~(s_granularity - 1));
+
+		// round up to the next second level class boundary
+		const auto most_significant_bit = static_cast<std::size_t>(std::bit_width(size) - 1);
+		const auto round = (std::size_t {1} << (most_significant_bit - s_second_level_count_log2)) - 1;
+
+		return mapping_insert(size + round);
+	}
+
+	auto two_level_segregated_fit::find_suitable_block(const mapping& mapping) const -> const block_index_t
+	{
+		if (mapping.m_first_level >= s_first_level_count) [[unlikely]]
+			return s_null_block;
+
+		auto first_level = mapping.m_first_level;
+		auto second_level_map = m_second_level_bitmaps[first_level] &
+								(~second_level_bitmap_t {} << mapping.m_second_level);
+
+		// no suitable block in this first level class, look into larger ones
+		if (not second_level_map)
+		{
+			const auto first_level_map = m_first_level_bitmap & (~first_level_bitmap_t {} << (first_level + 1));
+
+			if (not first_level_map) return s_null_block;
+
+			first_level = static_cast<std::size_t>(std::countr_zero(first_level_map));
+			second_level_map = m_second_level_bitmaps[first_level];
+		}
+
+		return m_free_lists[first_level][static_cast<std::size_t>(std::countr_zero(second_level_map))];
+	}
+
+	auto two_level_segregated_fit::insert_free_block(const block_index_t index) -> void
+	{
+		const auto [first_level, second_level] = mapping_insert(m_blocks[index].m_size);
+		auto& head = m_free_lists[first_level][second_level];
+
+		m_blocks[index].m_previous_free = s_null_block;
+		m_blocks[index].m_next_free = head;
+
+		if (head != s_null_block) m_blocks[head].m_previous_free = index;
+
+		head = index;
+
+		m_first_level_bitmap |= first_level_bitmap_t {1} << first_level;
+		m_second_level_bitmaps[first_level] |= second_level_bitmap_t {1} << second_level;
+		m_free_block_count++;
+	}
+
+	auto two_level_segregated_fit::remove_free_block(const block_index_t index) -> void
+	{
+		const auto [first_level, second_level] = mapping_insert(m_blocks[index].m_size);
+		const auto previous = m_blocks[index].m_previous_free;
+		const auto next = m_blocks[index].m_next_free;
+
+		m_free_block_count--;
+
+		if (next != s_null_block) m_blocks[next].m_previous_free = previous;
+
+		if (previous != s_null_block)
+		{
+			m_blocks[previous].m_next_free = next;
+			return;
+		}
+
+		// block was the head of its free list
+		m_free_lists[first_level][second_level] = next;
+
+		if (next == s_null_block)
+		{
+			m_second_level_bitmaps[first_level] &= ~(second_level_bitmap_t {1} << second_level);
+
+			if (not m_second_level_bitmaps[first_level])
+				m_first_level_bitmap &= ~(first_level_bitmap_t {1} << first_level);
+		}
+	}
+
+	auto two_level_segregated_fit::split_front(const block_index_t index, const std::size_t size) -> void
+	{
+		const auto front_index = create_block(m_blocks[index].m_offset, size);
+		auto& block = m_blocks[index];
+		auto& front = m_blocks[front_index];
+
+		front.m_previous_physical = block.m_previous_physical;
+		front.m_next_physical = index;
+
+		if (block.m_previous_physical != s_null_block)
+			m_blocks[block.m_previous_physical].m_next_physical = front_index;
+
+		block.m_previous_physical = front_index;
+		block.m_offset += size;
+		block.m_size -= size;
+
+		insert_free_block(front_index);
+	}
+
+	auto two_level_segregated_fit::split_back(const block_index_t index, const std::size_t size) -> void
+	{
+		const auto back_index = create_block(m_blocks[index].m_offset + size, m_blocks[index].m_size - size);
+		auto& block = m_blocks[index];
+		auto& back = m_blocks[back_index];
+
+		back.m_previous_physical = index;
+		back.m_next_physical = block.m_next_physical;
+
+		if (block.m_next_physical != s_null_block) m_blocks[block.m_next_physical].m_previous_physical = back_index;
+
+		block.m_next_physical = back_index;
+		block.m_size = size;
+
+		insert_free_block(back_index);
+	}
+
+	auto two_level_segregated_fit::create_block(const offset_t offset, const std::size_t size) -> const block_index_t
+	{
+		const auto block = two_level_segregated_fit::block {
+			offset, size, s_null_block, s_null_block, s_null_block, s_null_block, true};
+
+		if (not m_recycled_blocks.empty())
+		{
+			const auto index = m_recycled_blocks.back();
+			m_recycled_blocks.pop_back();
+			m_blocks[index] = block;
+
+			return index;
+		}
+
+		m_blocks.push_back(block);
+
+		return static_cast<block_index_t>(m_blocks.size() - 1);
+	}
+
+	auto two_level_segregated_fit::recycle_block(const block_index_t index) -> void
+	{
+		m_recycled_blocks.push_back(index);
+	}
+}
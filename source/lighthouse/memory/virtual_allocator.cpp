@@ -7,44 +7,99 @@ import output;
 namespace lh
 {
 	virtual_allocator::virtual_allocator(const std::size_t size, create_info create_info)
-		: m_virtual_block {vma::createVirtualBlock({size, create_info.m_create_flags})}, m_virtual_allocations {}
+		: m_virtual_block {vma::createVirtualBlock({size, create_info.m_create_flags})},
+		  m_virtual_allocations {},
+		  m_allocation_counters {}
 	{}
 
-	virtual_allocator::virtual_allocator(virtual_allocator&& other)
-		: m_virtual_block {std::exchange(other.m_virtual_block, {})}
+	virtual_allocator::virtual_allocator(virtual_allocator&& other) noexcept
+		: m_virtual_block {std::exchange(other.m_virtual_block, {})},
+		  m_virtual_allocations {std::exchange(other.m_virtual_allocations, {})},
+		  m_allocation_counters {std::exchange(other.m_allocation_counters, {})}
 	{}
 
-	auto virtual_allocator::operator=(virtual_allocator&& other) -> virtual_allocator&
+	auto virtual_allocator::operator=(virtual_allocator&& other) noexcept -> virtual_allocator&
 	{
+		if (m_virtual_block) m_virtual_block.destroy();
+
 		m_virtual_block = std::exchange(other.m_virtual_block, {});
+		m_virtual_allocations = std::exchange(other.m_virtual_allocations, {});
+		m_allocation_counters = std::exchange(other.m_allocation_counters, {});
 
 		return *this;
 	}
 
 	virtual_allocator::~virtual_allocator()
 	{
-		m_virtual_block.destroy();
+		if (m_virtual_block) m_virtual_block.destroy();
 	}
 
 	auto virtual_allocator::request_and_commit_suballocation(
 		const std::size_t size, const allocation_info& allocation_info) -> const memory_offset_t
+	{
+		const auto handle = request_and_commit_handle(size, allocation_info);
+
+		if (handle.m_offset != std::numeric_limits<memory_offset_t>::max())
+			m_virtual_allocations.insert(handle.m_offset, handle.m_allocation);
+
+		return handle.m_offset;
+	}
+
+	auto virtual_allocator::free_suballocation(const memory_offset_t offset) -> void
+	{
+		const auto allocation = m_virtual_allocations.extract(offset);
+
+		if (not allocation)
+		{
+			output::warning() << "virtual allocator has no suballocation at offset: " << offset;
+			return;
+		}
+
+		m_virtual_block.virtualFree(*allocation);
+		m_allocation_counters.record_free();
+	}
+
+	auto virtual_allocator::request_and_commit_handle(const std::size_t size, const allocation_info& allocation_info)
+		-> const handle
 	{
 		const auto create_info = vma::VirtualAllocationCreateInfo {size,
 																   allocation_info.m_alignment,
 																   allocation_info.m_allocation_flags};
-		auto offset = std::numeric_limits<memory_offset_t>::max();
-		auto allocation = vma::VirtualAllocation {};
+		auto handle = virtual_allocator::handle {};
 
-		std::ignore = m_virtual_block.virtualAllocate(&create_info, &allocation, &offset);
+		if (m_virtual_block.virtualAllocate(&create_info, &handle.m_allocation, &handle.m_offset) !=
+			vk::Result::eSuccess)
+			return {};
 
-		m_virtual_allocations.emplace(offset, allocation);
+		m_allocation_counters.record_allocation(size, m_virtual_block.getVirtualBlockStatistics().allocationBytes);
 
-		return offset;
+		return handle;
 	}
-	auto virtual_allocator::free_suballocation(const memory_offset_t offset) -> void
+
+	auto virtual_allocator::free_suballocation(const handle& handle) -> void
+	{
+		if (handle.m_offset == std::numeric_limits<memory_offset_t>::max()) return;
+
+		m_virtual_block.virtualFree(handle.m_allocation);
+		m_allocation_counters.record_free();
+	}
+
+	auto virtual_allocator::statistics() const -> const allocation_statistics
 	{
-		m_virtual_block.virtualFree(m_virtual_allocations[offset]);
+		const auto detailed_statistics = m_virtual_block.calculateVirtualBlockStatistics();
+		const auto& statistics = detailed_statistics.statistics;
+
+		auto result = allocation_statistics {
+			.m_reserved_bytes = statistics.blockBytes,
+			.m_used_bytes = statistics.allocationBytes,
+			.m_free_bytes = statistics.blockBytes - statistics.allocationBytes,
+			.m_largest_free_block_bytes = detailed_statistics.unusedRangeCount > 0
+											  ? detailed_statistics.unusedRangeSizeMax
+											  : 0,
+			.m_free_block_count = detailed_statistics.unusedRangeCount};
+
+		m_allocation_counters.fill(result);
 
-		m_virtual_allocations.erase(offset);
+		return result;
 	}
 }
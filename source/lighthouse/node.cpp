@@ -2,6 +2,8 @@ module;
 
 module node;
 
+import output;
+
 namespace lh
 {
 
@@ -12,83 +14,120 @@ namespace lh
 		return s_root_node;
 	}
 
+	auto node::transforms() -> transform_hierarchy&
+	{
+		static auto hierarchy = transform_hierarchy {};
+
+		return hierarchy;
+	}
+
 	node::node(node& parent,
 			   const geometry::transformation_t& transformation,
 			   destruction_strategy destruction_strategy)
-		: m_parent(&parent), m_transformation(transformation), m_destruction_mode(destruction_strategy), m_children {}
+		: m_parent {nullptr},
+		  m_first_child {nullptr},
+		  m_last_child {nullptr},
+		  m_previous_sibling {nullptr},
+		  m_next_sibling {nullptr},
+		  m_child_count {},
+		  m_transform {transforms().create(parent.transform_parent_of_children(), transformation)},
+		  m_destruction_mode(destruction_strategy)
 	{
-		m_parent->add_child(*this);
+		// the root node is its own parent, but not its own child
+		if (&parent == this)
+			m_parent = this;
+		else if (parent.detached())
+		{
+			output::warning() << "detached node can not adopt children, the node is attached to the root node";
+			link_to(s_root_node);
+		}
+		else
+			link_to(parent);
 	}
 
 	node::node(node&& other) noexcept
-		: m_parent {std::exchange(other.m_parent, nullptr)},
-		  m_children {std::exchange(other.m_children, {})},
-
-		  m_transformation {std::move(other.m_transformation)},
+		: m_parent {nullptr},
+		  m_first_child {nullptr},
+		  m_last_child {nullptr},
+		  m_previous_sibling {nullptr},
+		  m_next_sibling {nullptr},
+		  m_child_count {},
+		  m_transform {std::exchange(other.m_transform, {})},
 		  m_destruction_mode {std::exchange(other.m_destruction_mode, destruction_strategy::collapse)}
-	{}
+	{
+		take_place_of(other);
+	}
 
 	node& node::operator=(node&& other) noexcept
 	{
-		m_parent = std::exchange(other.m_parent, nullptr);
-		m_children = std::exchange(other.m_children, {});
-		m_transformation = std::move(other.m_transformation);
+		if (this == &other) return *this;
+
+		leave_hierarchy();
+
+		m_transform = std::exchange(other.m_transform, {});
 		m_destruction_mode = std::exchange(other.m_destruction_mode, destruction_strategy::collapse);
 
+		take_place_of(other);
+
 		return *this;
 	}
 
 	node::~node()
 	{
-		if (*this != s_root_node)
-		{
-			if (m_destruction_mode == destruction_strategy::collapse)
-			{
-				for (auto& child : m_children)
-				{
-					child->parent(*m_parent);
-					m_parent->add_child(*child);
-				}
-			} else if (m_destruction_mode == destruction_strategy::orphanage)
-			{
-				for (auto& child : m_children)
-				{
-					child->parent(s_root_node);
-					s_root_node.add_child(*child);
-				}
-			}
-
-			get_disowned();
-		}
+		leave_hierarchy();
 	}
 
 	auto node::parent(node& new_parent) -> void
 	{
-		get_disowned();
-
 		new_parent.add_child(*this);
-		m_parent = &new_parent;
 	}
 
 	auto node::parent() const -> node&
 	{
-		return *m_parent;
+		return detached() ? s_root_node : *m_parent;
 	}
 
 	auto node::add_child(node& child) -> void
 	{
-		m_children.push_back(&child);
-		child.parent() = std::move(*this);
+		if (detached())
+		{
+			output::warning() << "detached node can not adopt children";
+			return;
+		}
+
+		if (child == *this or child == s_root_node or is_descendent_of(child))
+		{
+			output::warning() << "node can not become a descendent of itself";
+			return;
+		}
+
+		if (child.detached())
+		{
+			child.m_transform = transforms().create(transform_parent_of_children());
+			child.link_to(*this);
+
+			return;
+		}
+
+		child.get_disowned();
+		child.link_to(*this);
+
+		transforms().reparent(child.m_transform, transform_parent_of_children());
 	}
 
 	auto node::remove_child(node& child) -> void
 	{
-		std::erase(m_children, &child);
+		if (child.m_parent == this) child.parent(s_root_node);
+	}
+
+	auto node::children() const -> children_t
+	{
+		return {child_iterator {m_first_child}, child_iterator {}};
 	}
 
-	auto node::children() const -> const std::vector<node*>&
+	auto node::child_count() const -> const std::size_t
 	{
-		return m_children;
+		return m_child_count;
 	}
 
 	auto node::is_ancestor_of(const node& node) const -> bool
@@ -98,21 +137,16 @@ namespace lh
 
 	auto node::is_descendent_of(const node& node) const -> bool
 	{
-		auto parent = m_parent;
-
-		while (*parent != s_root_node)
-		{
+		// detached nodes end their chain of ancestors without reaching the root node
+		for (auto parent = m_parent; parent and *parent != s_root_node; parent = parent->m_parent)
 			if (*parent == node) return true;
 
-			parent = &parent->parent();
-		}
-
 		return false;
 	}
 
 	auto node::is_sibling_of(const node& node) const -> bool
 	{
-		return std::ranges::contains(m_parent->children(), &node);
+		return m_parent and node.m_parent == m_parent;
 	}
 
 	auto node::descendent_count() const -> const std::size_t
@@ -126,26 +160,39 @@ namespace lh
 
 	auto node::local_transformation(const geometry::transformation_t& transformation) -> void
 	{
-		m_transformation = transformation;
+		if (detached())
+		{
+			output::warning() << "detached node has no transformation to change";
+			return;
+		}
+
+		transforms().local_transformation(m_transform, transformation);
 	}
 
 	auto node::local_transformation() const -> const geometry::transformation_t&
 	{
-		return m_transformation;
+		return detached() ? s_identity : transforms().local_transformation(m_transform);
 	}
 
 	auto node::global_transformation() const -> const geometry::transformation_t
 	{
-		auto global_transformation = m_transformation;
-		auto parent = m_parent;
+		return detached() ? s_identity : transforms().global_transformation(m_transform);
+	}
 
-		while (*parent != s_root_node)
-		{
-			global_transformation *= parent->local_transformation();
-			parent = &parent->parent();
-		}
+	auto node::update_global_transformations() -> void
+	{
+		if (*this == s_root_node)
+			transforms().update();
+		else
+			transforms().update(m_transform);
+	}
 
-		return global_transformation;
+	auto node::update_global_transformations(job_system& job_system) -> void
+	{
+		if (*this == s_root_node)
+			transforms().update(job_system);
+		else
+			transforms().update(m_transform);
 	}
 
 	auto node::operator==(const node& node) const -> bool
@@ -158,8 +205,133 @@ namespace lh
 		return this == &node;
 	}
 
+	auto node::detached() const -> bool
+	{
+		return not m_parent;
+	}
+
+	auto node::transform_parent_of_children() const -> transform_hierarchy::handle
+	{
+		return *this == s_root_node ? transform_hierarchy::handle {} : m_transform;
+	}
+
+	auto node::move_subtrees(std::span<node* const> subtrees, node& new_parent) -> void
+	{
+		for (const auto subtree : subtrees)
+			new_parent.add_child(*subtree);
+	}
+
+	auto node::destroy_subtree() -> void
+	{
+		if (*this == s_root_node)
+		{
+			output::warning() << "root node subtree can not be destroyed";
+			return;
+		}
+
+		get_disowned();
+
+		// the whole subtree occupies a single range of the transform hierarchy
+		transforms().destroy(m_transform);
+
+		auto pending_nodes = std::vector<node*> {this};
+
+		while (not pending_nodes.empty())
+		{
+			const auto current = pending_nodes.back();
+			pending_nodes.pop_back();
+
+			for (auto child = current->m_first_child; child; child = child->m_next_sibling)
+				pending_nodes.push_back(child);
+
+			current->m_parent = nullptr;
+			current->m_first_child = nullptr;
+			current->m_last_child = nullptr;
+			current->m_previous_sibling = nullptr;
+			current->m_next_sibling = nullptr;
+			current->m_child_count = 0;
+			current->m_transform = {};
+		}
+	}
+
 	auto node::get_disowned() -> void
 	{
-		if (this and *this != s_root_node) std::erase(const_cast<std::vector<node*>&>(m_parent->children()), this);
+		if (not m_parent or *this == s_root_node) return;
+
+		(m_previous_sibling ? m_previous_sibling->m_next_sibling : m_parent->m_first_child) = m_next_sibling;
+		(m_next_sibling ? m_next_sibling->m_previous_sibling : m_parent->m_last_child) = m_previous_sibling;
+		m_parent->m_child_count--;
+
+		m_parent = nullptr;
+		m_previous_sibling = nullptr;
+		m_next_sibling = nullptr;
+	}
+
+	auto node::link_to(node& parent) -> void
+	{
+		m_parent = &parent;
+		m_previous_sibling = parent.m_last_child;
+		m_next_sibling = nullptr;
+
+		(parent.m_last_child ? parent.m_last_child->m_next_sibling : parent.m_first_child) = this;
+		parent.m_last_child = this;
+		parent.m_child_count++;
+	}
+
+	auto node::leave_hierarchy() -> void
+	{
+		// detached nodes have nothing left to hand over
+		if (not m_parent or *this == s_root_node) return;
+
+		if (m_destruction_mode == destruction_strategy::collapse)
+		{
+			// children keep their place in the transform hierarchy, collapsing attaches them to our parent there
+			// our children list is spliced onto the end of our parents list as a whole
+			if (m_first_child)
+			{
+				for (auto child = m_first_child; child; child = child->m_next_sibling)
+					child->m_parent = m_parent;
+
+				m_first_child->m_previous_sibling = m_parent->m_last_child;
+				(m_parent->m_last_child ? m_parent->m_last_child->m_next_sibling : m_parent->m_first_child) =
+					m_first_child;
+				m_parent->m_last_child = m_last_child;
+				m_parent->m_child_count += m_child_count;
+
+				m_first_child = nullptr;
+				m_last_child = nullptr;
+				m_child_count = 0;
+			}
+		}
+		else
+		{
+			// children get reparented, which removes them from our children
+			while (m_first_child)
+				m_first_child->parent(s_root_node);
+		}
+
+		get_disowned();
+
+		transforms().collapse(m_transform);
+		m_transform = {};
+	}
+
+	auto node::take_place_of(node& other) -> void
+	{
+		m_parent = std::exchange(other.m_parent, nullptr);
+		m_first_child = std::exchange(other.m_first_child, nullptr);
+		m_last_child = std::exchange(other.m_last_child, nullptr);
+		m_previous_sibling = std::exchange(other.m_previous_sibling, nullptr);
+		m_next_sibling = std::exchange(other.m_next_sibling, nullptr);
+		m_child_count = std::exchange(other.m_child_count, 0);
+
+		if (m_parent)
+		{
+			(m_previous_sibling ? m_previous_sibling->m_next_sibling : m_parent->m_first_child) = this;
+			(m_next_sibling ? m_next_sibling->m_previous_sibling : m_parent->m_last_child) = this;
+		}
+
+		for (auto child = m_first_child; child; child = child->m_next_sibling)
+			child->m_parent = this;
 	}
 }
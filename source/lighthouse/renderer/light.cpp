@@ -36,18 +36,24 @@ namespace lh
 		calculate_effective_radius();
 	}
 
+	physical_light::~physical_light()
+	{
+		if (m_light_update_queue_index != s_not_queued)
+			s_global_light_manager->m_changed_lights[m_light_update_queue_index] = nullptr;
+	}
+
 	auto physical_light::color(const colors::color& color) -> void
 	{
 		m_color = {color.r, color.g, color.b, m_color.a};
 		m_effective_radius = glm::sqrt(m_color.a / physical_light_distance_threshold);
 
-		update_light_on_stack();
+		request_light_update();
 	}
 
 	auto physical_light::intensity(const intensity_t& intensity) -> void
 	{
 		m_color.a = intensity;
-		update_light_on_stack();
+		request_light_update();
 
 		// given the inverse square intensity decay law, calculate the distance past which
 		// this lights contribution can be discarded
@@ -69,12 +75,12 @@ namespace lh
 
 	auto physical_light::on_position_change() -> void
 	{
-		update_light_on_stack();
+		request_light_update();
 	}
 
 	auto physical_light::on_rotation_change() -> void
 	{
-		update_light_on_stack();
+		request_light_update();
 	}
 
 	auto physical_light::calculate_effective_radius() -> void
@@ -82,6 +88,21 @@ namespace lh
 		m_effective_radius = glm::sqrt(m_color.a / physical_light_distance_threshold);
 	}
 
+	auto physical_light::request_light_update() -> void
+	{
+		if (notification_mode() == change_notification::immediate)
+		{
+			update_light_on_stack();
+			return;
+		}
+
+		if (m_light_update_queue_index == s_not_queued)
+		{
+			m_light_update_queue_index = s_global_light_manager->m_changed_lights.size();
+			s_global_light_manager->m_changed_lights.push_back(this);
+		}
+	}
+
 	// ===========================================================================
 
 	point_light::point_light(const lh::colors::color& color,
@@ -132,7 +153,7 @@ namespace lh
 	auto spot_light::spread_angle(const parameter_precision_t& spread_angle) -> void
 	{
 		m_spread_angle = spread_angle;
-		update_light_on_stack();
+		request_light_update();
 	}
 
 	auto spot_light::sharpness() const -> const parameter_precision_t&
@@ -143,7 +164,7 @@ namespace lh
 	auto spot_light::sharpness(const parameter_precision_t& sharpness) -> void
 	{
 		m_sharpness = sharpness;
-		update_light_on_stack();
+		request_light_update();
 	}
 
 	auto spot_light::update_light_on_stack() -> void
@@ -213,7 +234,7 @@ namespace lh
 	auto ambient_light::decay_factor(const parameter_precision_t& decay_factor) -> void
 	{
 		m_decay_factor = decay_factor;
-		update_light_on_stack();
+		request_light_update();
 	}
 
 	auto ambient_light::update_light_on_stack() -> void
@@ -238,6 +259,7 @@ namespace lh
 		  m_spot_lights {},
 		  m_directional_lights {},
 		  m_ambient_lights {},
+		  m_changed_lights {},
 		  m_light_resource_buffer {},
 		  m_light_device_addresses {}
 	{
@@ -343,4 +365,17 @@ namespace lh
 	{
 		return m_light_device_addresses;
 	}
+
+	auto global_light_manager::update() -> void
+	{
+		for (auto light : m_changed_lights)
+		{
+			if (not light) continue;
+
+			light->m_light_update_queue_index = physical_light::s_not_queued;
+			light->update_light_on_stack();
+		}
+
+		m_changed_lights.clear();
+	}
 }
@@ -3,42 +3,104 @@ module;
 module mesh;
 
 import vertex_format;
+import memory_object_pool;
 import index_format;
+import output;
 
 namespace lh
 {
-	mesh::mesh() : m_node {}, m_vertex_and_index_subdata {}, m_bounding_box {}, m_vertex_count {}, m_index_count {} {}
+	mesh::mesh()
+		: m_node {},
+		  m_vertex_and_index_subdata {},
+		  m_bounding_box {},
+		  m_vertex_count {},
+		  m_index_count {},
+		  m_instances {},
+		  m_slots_of_instances {},
+		  m_instance_slots {},
+		  m_free_instance_slots {},
+		  m_dirty_instances {},
+		  m_dirty_flags {},
+		  m_instance_buffer {nullptr},
+		  m_instance_mirror {nullptr, 0},
+		  m_instance_address {},
+		  m_mirror_requires_full_copy {false}
+	{}
 
 	mesh::mesh(const vulkan::buffer_subdata<buffer_type_t>& suballocated_buffer_data,
 			   const geometry::aabb& bounding_box,
 			   non_owning_ptr<lh::node> node)
-		: m_node {node ? std::shared_ptr<lh::node> {node} : std::make_shared<lh::node>()},
+		: m_node {node ? std::shared_ptr<lh::node> {node} : make_pooled<lh::node>()},
 		  m_vertex_and_index_subdata {suballocated_buffer_data},
 		  m_bounding_box {std::move(bounding_box)},
 		  m_vertex_count {m_vertex_and_index_subdata[0].m_size / sizeof vulkan::vertex},
-		  m_index_count {m_vertex_and_index_subdata[1].m_size / sizeof vulkan::vertex_index_t}
+		  m_index_count {m_vertex_and_index_subdata[1].m_size / sizeof vulkan::vertex_index_t},
+		  m_instances {},
+		  m_slots_of_instances {},
+		  m_instance_slots {},
+		  m_free_instance_slots {},
+		  m_dirty_instances {},
+		  m_dirty_flags {},
+		  m_instance_buffer {nullptr},
+		  m_instance_mirror {nullptr, 0},
+		  m_instance_address {},
+		  m_mirror_requires_full_copy {false}
 	{}
 
 	mesh::mesh(mesh&& other) noexcept
-		: object_index<mesh> {std::exchange(other, {})},
+		: object_index<mesh> {std::move(other)},
+		  registry_entry<mesh> {std::move(other)},
 		  m_node {std::exchange(other.m_node, {})},
 		  m_vertex_and_index_subdata {std::exchange(other.m_vertex_and_index_subdata, {})},
 		  m_bounding_box {std::exchange(other.m_bounding_box, {})},
 		  m_vertex_count {std::exchange(other.m_vertex_count, {})},
-		  m_index_count {std::exchange(other.m_index_count, {})}
-	{}
+		  m_index_count {std::exchange(other.m_index_count, {})},
+		  m_instances {std::exchange(other.m_instances, {})},
+		  m_slots_of_instances {std::exchange(other.m_slots_of_instances, {})},
+		  m_instance_slots {std::exchange(other.m_instance_slots, {})},
+		  m_free_instance_slots {std::exchange(other.m_free_instance_slots, {})},
+		  m_dirty_instances {std::exchange(other.m_dirty_instances, {})},
+		  m_dirty_flags {std::exchange(other.m_dirty_flags, {})},
+		  m_instance_buffer {std::exchange(other.m_instance_buffer, nullptr)},
+		  m_instance_mirror {std::exchange(other.m_instance_mirror, {nullptr, 0})},
+		  m_instance_address {std::exchange(other.m_instance_address, {})},
+		  m_mirror_requires_full_copy {std::exchange(other.m_mirror_requires_full_copy, false)}
+	{
+		if (m_instance_mirror.data()) m_instance_buffer->relocation_callback(m_instance_mirror, relocation_callback());
+	}
 
 	mesh& mesh::operator=(mesh&& other) noexcept
 	{
+		registry_entry<mesh>::operator=(std::move(other));
+
+		release_instance_mirror();
+
 		m_node = std::exchange(other.m_node, {});
 		m_vertex_and_index_subdata = std::exchange(other.m_vertex_and_index_subdata, {});
 		m_bounding_box = std::exchange(other.m_bounding_box, {});
 		m_vertex_count = std::exchange(other.m_vertex_count, {});
 		m_index_count = std::exchange(other.m_index_count, {});
+		m_instances = std::exchange(other.m_instances, {});
+		m_slots_of_instances = std::exchange(other.m_slots_of_instances, {});
+		m_instance_slots = std::exchange(other.m_instance_slots, {});
+		m_free_instance_slots = std::exchange(other.m_free_instance_slots, {});
+		m_dirty_instances = std::exchange(other.m_dirty_instances, {});
+		m_dirty_flags = std::exchange(other.m_dirty_flags, {});
+		m_instance_buffer = std::exchange(other.m_instance_buffer, nullptr);
+		m_instance_mirror = std::exchange(other.m_instance_mirror, {nullptr, 0});
+		m_instance_address = std::exchange(other.m_instance_address, {});
+		m_mirror_requires_full_copy = std::exchange(other.m_mirror_requires_full_copy, false);
+
+		if (m_instance_mirror.data()) m_instance_buffer->relocation_callback(m_instance_mirror, relocation_callback());
 
 		return *this;
 	}
 
+	mesh::~mesh()
+	{
+		release_instance_mirror();
+	}
+
 	auto mesh::node() const -> const lh::node&
 	{
 		return *m_node;
@@ -74,19 +136,159 @@ namespace lh
 		return m_instances.size();
 	}
 
-	auto mesh::add_instance(const instance_t& instance) -> void
+	auto mesh::add_instance(const instance_t& instance) -> instance_handle
+	{
+		auto slot_index = static_cast<instance_handle::index_t>(m_instance_slots.size());
+
+		if (m_free_instance_slots.empty())
+			m_instance_slots.emplace_back(s_null_instance_index, instance_handle::generation_t {});
+		else
+		{
+			slot_index = m_free_instance_slots.back();
+			m_free_instance_slots.pop_back();
+		}
+
+		const auto position = static_cast<instance_handle::index_t>(m_instances.size());
+		m_instance_slots[slot_index].m_instance = position;
+
+		m_instances.push_back(instance);
+		m_slots_of_instances.push_back(slot_index);
+		m_dirty_flags.push_back(false);
+
+		mark_dirty(position);
+
+		return {slot_index, m_instance_slots[slot_index].m_generation};
+	}
+
+	auto mesh::add_instances(std::span<const instance_t> instances) -> std::vector<instance_handle>
+	{
+		auto handles = std::vector<instance_handle> {};
+
+		handles.reserve(instances.size());
+		m_instances.reserve(m_instances.size() + instances.size());
+		m_slots_of_instances.reserve(m_slots_of_instances.size() + instances.size());
+		m_dirty_flags.reserve(m_dirty_flags.size() + instances.size());
+		m_dirty_instances.reserve(m_dirty_instances.size() + instances.size());
+
+		for (const auto& instance : instances)
+			handles.push_back(add_instance(instance));
+
+		return handles;
+	}
+
+	auto mesh::remove_instance(const instance_handle& handle) -> void
+	{
+		if (not valid(handle)) return;
+
+		auto& slot = m_instance_slots[handle.m_index];
+		const auto position = slot.m_instance;
+		const auto last_slot = m_slots_of_instances.back();
+
+		// move the last instance into the vacated position
+		m_instances[position] = m_instances.back();
+		m_slots_of_instances[position] = last_slot;
+		m_instance_slots[last_slot].m_instance = position;
+
+		m_instances.pop_back();
+		m_slots_of_instances.pop_back();
+		m_dirty_flags.pop_back();
+
+		// the moved instance needs to be mirrored at its new position, unless the removed instance was the last one
+		if (position < m_instances.size()) mark_dirty(position);
+
+		slot.m_instance = s_null_instance_index;
+		slot.m_generation++;
+		m_free_instance_slots.push_back(handle.m_index);
+	}
+
+	auto mesh::valid(const instance_handle& handle) const -> bool
+	{
+		return handle.m_index < m_instance_slots.size() and
+			   m_instance_slots[handle.m_index].m_instance != s_null_instance_index and
+			   m_instance_slots[handle.m_index].m_generation == handle.m_generation;
+	}
+
+	auto mesh::instance(const instance_handle& handle, const instance_t& instance) -> void
 	{
-		m_instances.emplace_back(instance);
+		if (not valid(handle)) return;
+
+		const auto position = m_instance_slots[handle.m_index].m_instance;
+
+		m_instances[position] = instance;
+		mark_dirty(position);
 	}
 
-	auto mesh::add_instances(const std::vector<instance_t>& instances) -> void
+	auto mesh::instance(const instance_handle& handle) const -> const instance_t&
 	{
-		m_instances.insert_range(m_instances.end(), std::move(instances));
+		if (not valid(handle))
+		{
+			output::warning() << "stale mesh instance handle, returning the identity";
+			return s_identity_instance;
+		}
+
+		return m_instances[m_instance_slots[handle.m_index].m_instance];
 	}
 
-	auto mesh::remove_instance(const instance_t& instance) -> void
+	auto mesh::instances() const -> std::span<const instance_t>
 	{
-		std::erase(m_instances, instance);
+		return m_instances;
+	}
+
+	auto mesh::mirror_instances(instance_buffer_t& instance_buffer) -> void
+	{
+		if (m_instance_mirror.size() < m_instances.size())
+		{
+			const auto capacity = std::max({m_instances.size(), m_instance_mirror.size() * 2, s_min_mirrored_instances});
+
+			release_instance_mirror();
+
+			m_instance_buffer = &instance_buffer;
+			m_instance_mirror =
+				instance_buffer.request_and_commit_movable_span<instance_t>(capacity, relocation_callback());
+			m_instance_address = m_instance_mirror.data() ? instance_buffer.span_device_address(m_instance_mirror)
+														  : vk::DeviceAddress {};
+			m_mirror_requires_full_copy = true;
+		}
+
+		const auto instance_count = m_instances.size();
+
+		if (m_instance_mirror.data() and m_mirror_requires_full_copy)
+		{
+			std::ranges::copy(m_instances, m_instance_mirror.begin());
+			m_mirror_requires_full_copy = false;
+		}
+		else if (m_instance_mirror.data())
+		{
+			std::ranges::sort(m_dirty_instances);
+
+			// runs of adjacent dirty positions are copied as a single range, positions past the end were removed
+			for (auto first = m_dirty_instances.begin(); first != m_dirty_instances.end() and *first < instance_count;)
+			{
+				auto last = std::next(first);
+
+				while (last != m_dirty_instances.end() and *last <= *std::prev(last) + 1 and *last < instance_count)
+					last++;
+
+				const auto first_position = *first;
+				const auto end_position = *std::prev(last) + 1;
+
+				std::copy(m_instances.begin() + first_position,
+						  m_instances.begin() + end_position,
+						  m_instance_mirror.begin() + first_position);
+
+				first = last;
+			}
+		}
+
+		for (const auto position : m_dirty_instances)
+			if (position < instance_count) m_dirty_flags[position] = false;
+
+		m_dirty_instances.clear();
+	}
+
+	auto mesh::instance_address() const -> const vk::DeviceAddress
+	{
+		return m_instance_address;
 	}
 
 	auto mesh::bind(const vk::raii::CommandBuffer& command_buffer) const -> void
@@ -99,4 +301,29 @@ namespace lh
 									   m_vertex_and_index_subdata.m_subdata[1].m_offset,
 									   vk::IndexType::eUint32);
 	}
+
+	auto mesh::relocation_callback() -> instance_buffer_t::relocation_callback_t
+	{
+		// the contents were copied over by the defragmentation pass, only the span and its address change
+		return [this](const auto&, const auto& destination) {
+			m_instance_mirror = m_instance_buffer->span<instance_t>(destination);
+			m_instance_address = m_instance_buffer->range_address(destination);
+		};
+	}
+
+	auto mesh::mark_dirty(const instance_handle::index_t position) -> void
+	{
+		if (m_dirty_flags[position]) return;
+
+		m_dirty_flags[position] = true;
+		m_dirty_instances.push_back(position);
+	}
+
+	auto mesh::release_instance_mirror() -> void
+	{
+		if (m_instance_buffer and m_instance_mirror.data()) m_instance_buffer->free_span(m_instance_mirror);
+
+		m_instance_mirror = {nullptr, 0};
+		m_instance_address = {};
+	}
 }
@@ -16,7 +16,7 @@ namespace lh
 								 const vulkan::memory_allocator& memory_allocator,
 								 vulkan::transfer_queue& transfer_queue,
 								 const create_info& create_info)
-		: m_default_meshes {}, m_mesh_buffers {}
+		: m_default_meshes {}, m_default_mesh_bvhs {}, m_mesh_buffers {}
 	{
 		const auto paths = std::vector<std::filesystem::path> {create_info.m_plane_mesh,
 															   create_info.m_cube_mesh,
@@ -55,6 +55,7 @@ namespace lh
 				{{data.m_vertex_offset, data.m_vertex_buffer_size}, {data.m_index_offset, data.m_index_buffer_size}}};
 
 			m_default_meshes[i] = {buffer_subdata, data.m_bounding_box};
+			m_default_mesh_bvhs.emplace_back(mesh_data, i);
 		}
 	}
 
@@ -82,4 +83,34 @@ namespace lh
 	{
 		return m_default_meshes[4];
 	}
-}
+
+	auto mesh_registry::plane() -> lh::mesh&
+	{
+		return m_default_meshes[0];
+	}
+
+	auto mesh_registry::cube() -> lh::mesh&
+	{
+		return m_default_meshes[1];
+	}
+
+	auto mesh_registry::sphere() -> lh::mesh&
+	{
+		return m_default_meshes[2];
+	}
+
+	auto mesh_registry::cylinder() -> lh::mesh&
+	{
+		return m_default_meshes[3];
+	}
+
+	auto mesh_registry::cone() -> lh::mesh&
+	{
+		return m_default_meshes[4];
+	}
+
+	auto mesh_registry::bvh_of(const default_meshes mesh) const -> const geometry::bvh&
+	{
+		return m_default_mesh_bvhs[std::to_underlying(mesh)];
+	}
+}
\ No newline at end of file
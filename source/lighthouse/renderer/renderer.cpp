@@ -13,6 +13,12 @@ import file_system;
 import time;
 import glm;
 import collision;
+import bvh;
+import frustum;
+import memory_object_pool;
+import entity;
+import geometry;
+import color;
 
 // #pragma optimize("", off)
 namespace lh
@@ -20,6 +26,7 @@ namespace lh
 	renderer::renderer(const window& window, const create_info& create_info)
 		: m_create_info {create_info},
 		  m_window {window},
+		  m_frame_arena {create_info.m_frame_arena_size},
 		  m_instance(window,
 					 vulkan::instance::create_info {.m_engine_version = create_info.m_engine_version,
 													.m_vulkan_version = create_info.m_vulkan_version}),
@@ -67,6 +74,12 @@ namespace lh
 		  m_global_light_manager {m_physical_device, m_logical_device, m_memory_allocator},
 		  m_global_descriptor_buffer {m_physical_device, m_logical_device, m_memory_allocator, m_pipeline_layout},
 		  m_push_constant {},
+		  m_instance_buffer {
+			  m_logical_device,
+			  m_memory_allocator,
+			  create_info.m_max_instances *
+				  (sizeof(glm::mat4x4) + sizeof(std::uint32_t) * buffered_frame_arena<>::s_frame_count)},
+		  m_visible_instances(buffered_frame_arena<>::s_frame_count, {nullptr, 0}),
 		  m_mesh_registry {m_logical_device,
 						   m_memory_allocator,
 						   m_transfer_queue,
@@ -78,7 +91,6 @@ namespace lh
 		  /*m_mapped_range {m_logical_device,
 						  m_memory_allocator,
 						  m_physical_device.properties().m_memory_properties.m_host_visible},*/
-		  m_instance_buffer {m_logical_device, m_memory_allocator, 1000 * sizeof glm::mat4x4},
 		  m_test_pipeline {m_physical_device,
 						   m_logical_device,
 						   m_memory_allocator,
@@ -87,7 +99,6 @@ namespace lh
 						   m_pipeline_layout,
 						   m_global_descriptor_buffer},
 		  // m_scene_loader {m_logical_device, m_memory_allocator, file_system::data_path() /= "meshes/cube.obj"},
-		  m_camera {std::make_shared<lh::node>(), camera<camera_type::perspective>::create_info {}},
 		  m_material {m_physical_device,
 					  m_logical_device,
 					  m_memory_allocator,
@@ -96,14 +107,8 @@ namespace lh
 					   file_system::data_path() /= "images/grooved_bricks/normal.png",
 					   file_system::data_path() /= "images/grooved_bricks/ambientocclusion.png"},
 					  m_global_descriptor_buffer},
-		  m_point_light {{1.0f, 0.0f, 0.0f, 1.0f}, 1.0f, {0.0f, 0.0f, 0.0f}},
-		  m_point_light2 {{0.0f, 1.0f, 0.0f, 1.0f}, 1.0f, {0.0f, 1.0f, 0.0f}},
-		  m_spot_light {{0.5f, 0.5f, 0.0f, 1.0f}, 1.0f, {0.0f, 0.0f, 1.0f}},
-		  m_spot_light2 {{0.0f, 0.5f, 0.5f, 1.0f}, 1.0f, {0.0f, 0.0f, 1.0f}},
-		  m_dir_light {{1.0f, 0.5f, 0.5f, 1.0f}, 1.0f, {0.0f, 0.0f, 1.0f}, {0.0f, -1.0f, 0.0f}},
-		  m_dir_light2 {{0.5f, 1.0f, 0.5f, 1.0f}, 1.0f, {0.0f, 0.0f, 1.0f}, {0.0f, -1.0f, 0.0f}},
-		  m_amb_light {{1.0f, 0.0f, 0.0f, 1.0f}, 1.0f, {1.0f, 0.0f, 0.0f}},
-		  m_amb_light2 {{0.0f, 1.0f, 0.0f, 1.0f}, 0.5f, {0.0f, 0.0f, 0.0f}},
+		  m_scene {},
+		  m_animated_light {nullptr},
 		  m_skybox {m_physical_device,
 					m_logical_device,
 					m_memory_allocator,
@@ -126,19 +131,39 @@ namespace lh
 		// m_global_descriptor_buffer.register_resource_buffer(m_test_pipeline.resource_buffer());
 		// m_global_descriptor_buffer.register_resource_buffer(m_skybox.pipeline().resource_buffer());
 
-		glm::mat4x4 sphere1 = glm::mat4x4 {1.0f};
-		glm::mat4x4 sphere2 = glm::translate(sphere1, glm::vec3 {0.0f, 10.0f, 0.0f});
-		glm::mat4x4 sphere3 = glm::translate(sphere1, glm::vec3 {0.0f, -10.0f, 0.0f});
-
-		glm::mat4x4 spheres[3] = {sphere1, sphere2, sphere3};
+		const auto sphere_transformation = glm::mat4x4 {1.0f};
+		const auto spheres = std::array<scene::object_create_info, 3> {
+			scene::object_create_info {&m_mesh_registry.sphere(), sphere_transformation},
+			scene::object_create_info {&m_mesh_registry.sphere(),
+									   glm::translate(sphere_transformation, glm::vec3 {0.0f, 10.0f, 0.0f})},
+			scene::object_create_info {&m_mesh_registry.sphere(),
+									   glm::translate(sphere_transformation, glm::vec3 {0.0f, -10.0f, 0.0f})}};
+
+		m_scene.create_objects(spheres);
+
+		m_animated_light = &m_scene.add_light<point_light>(
+			colors::color {1.0f, 0.0f, 0.0f, 1.0f}, 1.0f, geometry::position_t {0.0f, 0.0f, 0.0f});
+		m_scene.add_light<point_light>(
+			colors::color {0.0f, 1.0f, 0.0f, 1.0f}, 1.0f, geometry::position_t {0.0f, 1.0f, 0.0f});
+		m_scene.add_light<spot_light>(
+			colors::color {0.5f, 0.5f, 0.0f, 1.0f}, 1.0f, geometry::position_t {0.0f, 0.0f, 1.0f});
+		m_scene.add_light<spot_light>(
+			colors::color {0.0f, 0.5f, 0.5f, 1.0f}, 1.0f, geometry::position_t {0.0f, 0.0f, 1.0f});
+		m_scene.add_light<directional_light>(colors::color {1.0f, 0.5f, 0.5f, 1.0f},
+											 1.0f,
+											 geometry::position_t {0.0f, 0.0f, 1.0f},
+											 geometry::normal_t {0.0f, -1.0f, 0.0f});
+		m_scene.add_light<directional_light>(colors::color {0.5f, 1.0f, 0.5f, 1.0f},
+											 1.0f,
+											 geometry::position_t {0.0f, 0.0f, 1.0f},
+											 geometry::normal_t {0.0f, -1.0f, 0.0f});
+		m_scene.add_light<ambient_light>(
+			colors::color {1.0f, 0.0f, 0.0f, 1.0f}, 1.0f, geometry::position_t {1.0f, 0.0f, 0.0f});
+		auto& movable_light = m_scene.add_light<ambient_light>(
+			colors::color {0.0f, 1.0f, 0.0f, 1.0f}, 0.5f, geometry::position_t {0.0f, 0.0f, 0.0f});
+
+		auto& camera = m_scene.add_camera();
 
-		auto smb = m_instance_buffer.request_and_commit_span<glm::mat4x4>(3);
-		// std::cout << "instance buffer address: " << m_instance_buffer.memory_mapped_span::address() << '\n';
-
-		smb.emplace_back(sphere1);
-		smb.emplace_back(sphere2);
-		smb.emplace_back(sphere3);
-		m_push_constant.m_registers.m_address_1 = m_instance_buffer.span_device_address(smb);
 		m_push_constant.m_registers.m_address_2 = m_test.address();
 		/*m_instance_buffer.address();*/ /*smb.address();*/
 
@@ -149,46 +174,46 @@ namespace lh
 		output::dump_logs(std::cout);
 
 		input::key_binding::bind({vkfw::Key::A},
-								 [this]() { m_camera.translate_relative(m_camera.right_direction(), -0.1f); });
+								 [&camera]() { camera.translate_relative(camera.right_direction(), -0.1f); });
 		input::key_binding::bind({vkfw::Key::D},
-								 [this]() { m_camera.translate_relative(m_camera.right_direction(), 0.1f); });
+								 [&camera]() { camera.translate_relative(camera.right_direction(), 0.1f); });
 		input::key_binding::bind({vkfw::Key::W},
-								 [this]() { m_camera.translate_relative(m_camera.view_direction(), 0.1f); });
+								 [&camera]() { camera.translate_relative(camera.view_direction(), 0.1f); });
 		input::key_binding::bind({vkfw::Key::S},
-								 [this]() { m_camera.translate_relative(m_camera.view_direction(), -0.1f); });
+								 [&camera]() { camera.translate_relative(camera.view_direction(), -0.1f); });
 		input::key_binding::bind({vkfw::Key::Space},
-								 [this]() { m_camera.translate_relative(m_camera.up_direction(), 0.1f); });
+								 [&camera]() { camera.translate_relative(camera.up_direction(), 0.1f); });
 		input::key_binding::bind({vkfw::Key::C},
-								 [this]() { m_camera.translate_relative(m_camera.up_direction(), -0.1f); });
+								 [&camera]() { camera.translate_relative(camera.up_direction(), -0.1f); });
 
 		input::key_binding::bind({vkfw::Key::E},
-								 [this]() { m_camera.look_at(geometry::position_t {0.05f, 0.05f, 0.05f}); });
-		/*
-		input::key_binding::bind({vkfw::Key::B}, [this]() {
-			const auto ray = geometry::ray {m_camera.position(), m_camera.view_direction()};
+								 [&camera]() { camera.look_at(geometry::position_t {0.05f, 0.05f, 0.05f}); });
+		input::key_binding::bind({vkfw::Key::B}, [this, &camera]() {
+			const auto& sphere_bvh = m_mesh_registry.bvh_of(mesh_registry::default_meshes::sphere);
 
-			if (collision::ray_aabb_test(ray, m_mesh_registry.sphere().bounding_box()))
+			// the camera ray is brought into the space of each instance, where the hierarchy was built
+			for (auto i = std::size_t {}; const auto& instance : m_mesh_registry.sphere().instances())
 			{
-				std::cout << "found aabb\n";
-				for (size_t i = 0; i < m_mesh_registry.sphere().indices().size() - 3; i += 3)
-				{
-					const auto indices = std::array<uint32_t, 3> {m_mesh_registry.sphere().indices()[i],
-																  m_mesh_registry.sphere().indices()[i + 1],
-																  m_mesh_registry.sphere().indices()[i + 2]};
-
-					const auto triangle =
-						geometry::triangle {m_mesh_registry.sphere().vertices()[indices[0]].m_position,
-											m_mesh_registry.sphere().vertices()[indices[1]].m_position,
-											m_mesh_registry.sphere().vertices()[indices[2]].m_position};
-
-					if (collision::ray_tri_test(ray, triangle)) std::cout << "got it after: " << i << '\n';
-				}
+				const auto inverse_instance = glm::inverse(instance);
+				const auto ray =
+					geometry::ray {geometry::position_t {inverse_instance * glm::vec4 {camera.position(), 1.0f}},
+								   geometry::normal_t {inverse_instance * glm::vec4 {camera.view_direction(), 0.0f}}};
+
+				if (const auto hit = sphere_bvh.closest_hit(ray); hit.hit())
+					output::log() << "hit sphere instance " << i << " at triangle " << hit.m_triangle;
+
+				i++;
 			}
-		});*/
+		});
+
+		input::mouse::move_callback(camera.first_person_callback());
 
-		input::mouse::move_callback(m_camera.first_person_callback());
+		// animated lights are written to the light stack once per frame, regardless of how often they move
+		m_animated_light->notification_mode(entity::change_notification::deferred);
+		movable_light.notification_mode(entity::change_notification::deferred);
 
-		input::key_binding::bind({vkfw::Key::P}, [this]() { m_amb_light2.translate_relative({0.0f, 0.1f, 0.0f}); });
+		input::key_binding::bind({vkfw::Key::P},
+								 [&movable_light]() { movable_light.translate_relative({0.0f, 0.1f, 0.0f}); });
 	}
 
 	auto renderer::push_constants() const -> void
@@ -203,8 +228,15 @@ namespace lh
 	// ===========================================================================
 	// ===========================================================================
 
+	auto renderer::frame_arena() -> lh::frame_arena&
+	{
+		return m_frame_arena.current();
+	}
+
 	auto renderer::render() -> void
 	{
+		m_frame_arena.next_frame();
+
 		// m_graphics_queue.wait();
 		m_graphics_queue.command_control().reset();
 
@@ -238,16 +270,51 @@ namespace lh
 		};
 
 		auto time = time::now();
-		m_point_light.translate_absolute({0.0f, glm::sin(time), 0.0f});
+		m_animated_light->translate_absolute({0.0f, glm::sin(time), 0.0f});
 
-		auto skybox_view_test = m_camera.view();
+		const auto& camera = m_scene.active_camera();
+
+		auto skybox_view_test = camera.view();
 		skybox_view_test[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
 
-		glm::mat4x4 sphere1 = glm::mat4x4 {1.0f};
-		glm::mat4x4 sphere2 = glm::translate(sphere1, glm::vec3 {0.0f, 10.0f, 0.0f});
-		glm::mat4x4 sphere3 = glm::translate(sphere1, glm::vec3 {0.0f, -10.0f, 0.0f});
-		test scene {{sphere1, sphere2, sphere3}, m_camera.view(), m_camera.projection(), {time, time, time, time}};
-		test2 sb_scene = {glm::mat4x4 {1.0f}, m_camera.view(), m_camera.projection(), {time, time, time, time}};
+		// moved scene objects update their mesh instances, which mirror only what changed
+		m_scene.update();
+
+		auto& sphere = m_mesh_registry.sphere();
+		sphere.mirror_instances(m_instance_buffer);
+
+		// only instances whose bounds reach into the view frustum are drawn, their indices are compacted into the span
+		// of this frame, through which the shader reads the transformations from the mirror of every instance
+		const auto view_frustum = geometry::frustum {camera.projection() * camera.view()};
+		auto visible_instances = m_frame_arena.vector<std::uint32_t>(sphere.instance_count());
+		visible_instances.resize(
+			geometry::cull(view_frustum, sphere.bounding_box(), sphere.instances(), visible_instances));
+
+		// the span was last read by the frame that used this arena, which has completed
+		auto& visible_span = m_visible_instances[m_frame_arena.frame_index()];
+
+		if (visible_span.size() < visible_instances.size())
+		{
+			if (visible_span.data()) m_instance_buffer.free_span(visible_span);
+
+			visible_span = m_instance_buffer.request_and_commit_span<std::uint32_t>(
+				std::max(visible_instances.size(), visible_span.size() * 2));
+
+			if (not visible_span.data())
+				output::warning() << "could not allocate visible instance indices, " << visible_instances.size()
+								  << " visible instances are not drawn";
+		}
+
+		const auto visible_count = std::min(visible_instances.size(), visible_span.size());
+
+		std::ranges::copy(visible_instances | std::views::take(visible_count), visible_span.begin());
+
+		m_push_constant.m_registers.m_address_1 = sphere.instance_address();
+		m_push_constant.m_registers.m_address_3 =
+			visible_span.data() ? m_instance_buffer.span_device_address(visible_span) : vk::DeviceAddress {};
+
+		test scene {{}, camera.view(), camera.projection(), {time, time, time, time}};
+		test2 sb_scene = {glm::mat4x4 {1.0f}, camera.view(), camera.projection(), {time, time, time, time}};
 		// auto sb_scene = scene;
 		sb_scene.view[3] = glm::vec4 {0.0f, 0.0f, 0.0f, 1.0f};
 
@@ -267,20 +334,22 @@ namespace lh
 		if (imgui_io.WantCaptureMouse)
 			input::mouse::move_callback([](auto wtf) {});
 		else
-			input::mouse::move_callback(m_camera.first_person_callback());
+			input::mouse::move_callback(camera.first_person_callback());
 		// done testing
 
 		// draw sphere
 
-		m_mesh_registry.sphere().bind(command_buffer);
+		sphere.bind(command_buffer);
 		m_test_pipeline.bind(command_buffer);
 		m_test_pipeline.resource_buffer().map_uniform_data(0, scene);
 		m_test_pipeline.resource_buffer().map_uniform_data(1, mi);
 		m_test_pipeline.resource_buffer().map_storage_data(0, mi);
+		entity::dispatch_deferred_changes();
+		m_global_light_manager.update();
 		m_test_pipeline.resource_buffer().map_storage_data(1, m_global_light_manager.light_device_addresses());
 
 		push_constants();
-		command_buffer.drawIndexed(m_mesh_registry.sphere().index_count(), 3, 0, 0, 0);
+		command_buffer.drawIndexed(sphere.index_count(), static_cast<std::uint32_t>(visible_count), 0, 0, 0);
 
 		/*
 		const auto barrier = vk::MemoryBarrier2 {{vk::PipelineStageFlagBits2::eAllCommands},
@@ -305,6 +374,8 @@ namespace lh
 		m_user_interface.new_frame();
 		m_user_interface.draw_crosshair();
 		m_user_interface.draw_gpu_budgets(m_memory_allocator.budget());
+		m_user_interface.draw_allocation_statistics("instance buffer", m_instance_buffer.statistics());
+		m_user_interface.draw_allocation_statistics("frame arena", m_frame_arena.current().statistics());
 		m_user_interface.render(command_buffer);
 
 		command_buffer.endRendering();
@@ -6,6 +6,7 @@ module;
 module user_interface;
 
 import lighthouse_string;
+import time;
 
 namespace lh
 {
@@ -170,6 +171,83 @@ namespace lh
 		ImGui::End();
 	}
 
+	auto user_interface::draw_allocation_statistics(const string::string_t& name,
+													const allocation_statistics& statistics) -> void
+	{
+		// rates are averaged over sampling periods of at least a second
+		const auto now = time::now();
+		auto& sample = m_allocation_rate_samples
+						   .try_emplace(name,
+										allocation_rate_sample {now,
+																statistics.m_total_allocation_count,
+																statistics.m_total_free_count,
+																0.0f,
+																0.0f})
+						   .first->second;
+
+		if (const auto elapsed = now - sample.m_time; elapsed >= 1.0)
+		{
+			sample.m_allocation_rate = static_cast<float>(
+				static_cast<double>(statistics.m_total_allocation_count - sample.m_total_allocation_count) / elapsed);
+			sample.m_free_rate = static_cast<float>(
+				static_cast<double>(statistics.m_total_free_count - sample.m_total_free_count) / elapsed);
+			sample.m_time = now;
+			sample.m_total_allocation_count = statistics.m_total_allocation_count;
+			sample.m_total_free_count = statistics.m_total_free_count;
+		}
+
+		ImGui::Begin("allocation statistics");
+
+		if (ImGui::CollapsingHeader(name.c_str(), ImGuiTreeNodeFlags_None))
+		{
+			ImGui::Text("reserved bytes: %zu", statistics.m_reserved_bytes);
+			ImGui::Text("used bytes: %zu", statistics.m_used_bytes);
+			ImGui::Text("free bytes: %zu", statistics.m_free_bytes);
+			ImGui::Text("peak used bytes: %zu", statistics.m_peak_used_bytes);
+
+			ImGui::Text("free block count: %zu", statistics.m_free_block_count);
+			ImGui::Text("largest free block bytes: %zu", statistics.m_largest_free_block_bytes);
+			ImGui::Text("fragmentation: %.2f%%", statistics.fragmentation() * 100);
+
+			ImGui::Text("allocation count: %zu", statistics.m_allocation_count);
+			ImGui::Text("allocations per second: %.1f", sample.m_allocation_rate);
+			ImGui::Text("frees per second: %.1f", sample.m_free_rate);
+			ImGui::Text("total alignment padding bytes: %zu", statistics.m_total_alignment_padding_bytes);
+
+			// log2 allocation size histogram, trimmed to the range of sizes seen so far
+			const auto& histogram = statistics.m_allocation_size_histogram;
+			const auto first = std::ranges::find_if(histogram, [](const auto count) { return count > 0; });
+			const auto last = std::ranges::find_if(histogram.rbegin(), histogram.rend(), [](const auto count) {
+								  return count > 0;
+							  }).base();
+
+			if (first < last)
+			{
+				auto buckets = std::array<float, std::tuple_size_v<allocation_statistics::allocation_size_histogram_t>> {};
+				const auto bucket_count = static_cast<int>(last - first);
+
+				std::ranges::transform(first, last, buckets.begin(), [](const auto count) {
+					return static_cast<float>(count);
+				});
+
+				const auto overlay_text = lh::string::string_t {
+					"allocation sizes 2^" + std::to_string(first - histogram.begin()) + " to 2^" +
+					std::to_string(last - histogram.begin())};
+
+				ImGui::PlotHistogram("##allocation sizes",
+									 buckets.data(),
+									 bucket_count,
+									 0,
+									 overlay_text.c_str(),
+									 0.0f,
+									 std::numeric_limits<float>::max(),
+									 ImVec2 {0.0f, 80.0f});
+			}
+		}
+
+		ImGui::End();
+	}
+
 	auto user_interface::register_key_event(const input::key_binding::key_input& key_input, const action& action)
 		-> void
 	{}
@@ -2,10 +2,341 @@ module;
 
 module scene;
 
+import output;
+
 namespace lh
 {
-	/*
-	auto scene::generate_mesh_subdata(const scene_data& scene_data) const
-		-> const vulkan::buffer_subdata<vulkan::buffer>
-	{}*/
+	scene::object::object(lh::node& parent,
+						  const geometry::transformation_t& transformation,
+						  const non_owning_ptr<lh::mesh> mesh)
+		: m_node {parent, transformation},
+		  m_mesh {mesh},
+		  m_instance {mesh ? mesh->add_instance(transformation) : lh::mesh::instance_handle {}},
+		  m_bounds {},
+		  m_spatial_entry {},
+		  m_moved {false}
+	{}
+
+	scene::object::~object()
+	{
+		if (m_mesh) m_mesh->remove_instance(m_instance);
+	}
+
+	scene::scene(const create_info& create_info)
+		: m_create_info {validated(create_info)},
+		  m_meshes {},
+		  m_objects {},
+		  m_objects_by_node {},
+		  m_moved_objects {},
+		  m_spatial_index {{m_create_info.m_spatial_index_root_size, m_create_info.m_spatial_index_max_depth}},
+		  m_lights {},
+		  m_cameras {},
+		  m_active_camera {nullptr}
+	{}
+
+	auto scene::create_object(const object_create_info& create_info) -> handle
+	{
+		const auto handle = m_objects.create(parent_node(create_info.m_parent),
+											 create_info.m_transformation,
+											 create_info.m_mesh);
+		auto& object = object_at(handle);
+
+		m_objects_by_node.emplace(&object.m_node, handle);
+
+		object.m_moved = true;
+		m_moved_objects.push_back(handle);
+
+		return handle;
+	}
+
+	auto scene::create_objects(std::span<const object_create_info> create_infos) -> std::vector<handle>
+	{
+		auto handles = std::vector<handle> {};
+
+		handles.reserve(create_infos.size());
+		m_objects_by_node.reserve(m_objects_by_node.size() + create_infos.size());
+		m_moved_objects.reserve(m_moved_objects.size() + create_infos.size());
+
+		for (const auto& create_info : create_infos)
+			handles.push_back(create_object(create_info));
+
+		return handles;
+	}
+
+	auto scene::destroy_object(const handle& handle) -> void
+	{
+		destroy_objects({&handle, 1});
+	}
+
+	auto scene::destroy_objects(std::span<const handle> handles) -> void
+	{
+		// children surviving the batch move along with their new parent, they are marked once all objects are gone
+		auto orphans = std::vector<handle> {};
+
+		for (const auto& handle : handles)
+		{
+			if (not valid(handle)) continue;
+
+			for (const auto child : object_at(handle).m_node.children())
+				if (const auto orphan = m_objects_by_node.find(child); orphan != m_objects_by_node.end())
+					orphans.push_back(orphan->second);
+
+			release(handle);
+		}
+
+		for (const auto& orphan : orphans)
+			if (valid(orphan)) mark_moved(object_at(orphan).m_node);
+	}
+
+	auto scene::reparent_object(const handle& handle, const handle& parent) -> void
+	{
+		reparent_objects({&handle, 1}, parent);
+	}
+
+	auto scene::reparent_objects(std::span<const handle> handles, const handle& parent) -> void
+	{
+		auto& new_parent = parent_node(parent);
+
+		for (const auto& handle : handles)
+		{
+			if (not valid(handle)) continue;
+
+			auto& node = object_at(handle).m_node;
+
+			if (node == new_parent or new_parent.is_descendent_of(node))
+			{
+				output::warning() << "scene object can not be parented to itself or one of its descendants";
+				continue;
+			}
+
+			node.parent(new_parent);
+			mark_moved(node);
+		}
+	}
+
+	auto scene::transform_object(const handle& handle, const geometry::transformation_t& transformation) -> void
+	{
+		if (not valid(handle)) return;
+
+		auto& node = object_at(handle).m_node;
+
+		node.local_transformation(transformation);
+		mark_moved(node);
+	}
+
+	auto scene::valid(const handle& handle) const -> bool
+	{
+		return m_objects.valid(handle);
+	}
+
+	auto scene::node(const handle& handle) const -> const lh::node&
+	{
+		return object_at(handle).m_node;
+	}
+
+	auto scene::mesh(const handle& handle) const -> non_owning_ptr<const lh::mesh>
+	{
+		return object_at(handle).m_mesh;
+	}
+
+	auto scene::bounds(const handle& handle) const -> const geometry::aabb&
+	{
+		return object_at(handle).m_bounds;
+	}
+
+	auto scene::object_count() const -> const std::size_t
+	{
+		return m_objects.size();
+	}
+
+	auto scene::update() -> void
+	{
+		for (const auto& handle : m_moved_objects)
+		{
+			// destroyed after being moved
+			if (not valid(handle)) continue;
+
+			auto& object = object_at(handle);
+			object.m_moved = false;
+
+			const auto local_bounds = object.m_mesh ? object.m_mesh->bounding_box()
+													  : geometry::aabb {geometry::position_t {0.0f}, geometry::position_t {0.0f}};
+			const auto transformation = object.m_node.global_transformation();
+
+			auto minima = geometry::position_t {std::numeric_limits<geometry::scalar_t>::max()};
+			auto maxima = geometry::position_t {std::numeric_limits<geometry::scalar_t>::lowest()};
+
+			for (auto corner = 0; corner < 8; corner++)
+			{
+				const auto local_corner = geometry::position_t {
+					corner & 1 ? local_bounds.m_maxima.x : local_bounds.m_minima.x,
+					corner & 2 ? local_bounds.m_maxima.y : local_bounds.m_minima.y,
+					corner & 4 ? local_bounds.m_maxima.z : local_bounds.m_minima.z};
+				const auto world_corner = geometry::position_t {transformation * geometry::vec4_t {local_corner, 1.0f}};
+
+				minima = glm::min(minima, world_corner);
+				maxima = glm::max(maxima, world_corner);
+			}
+
+			object.m_bounds = {minima, maxima};
+
+			if (object.m_mesh) object.m_mesh->instance(object.m_instance, transformation);
+
+			if (m_spatial_index.valid(object.m_spatial_entry))
+				m_spatial_index.move(object.m_spatial_entry, object.m_bounds);
+			else
+				object.m_spatial_entry = m_spatial_index.insert(object.m_bounds, handle);
+		}
+
+		m_moved_objects.clear();
+	}
+
+	auto scene::objects_within(const geometry::aabb& volume) const -> std::vector<handle>
+	{
+		auto result = std::vector<handle> {};
+
+		m_spatial_index.query(volume, [&result](const handle& handle) { result.push_back(handle); });
+
+		return result;
+	}
+
+	auto scene::objects_within(const geometry::sphere& volume) const -> std::vector<handle>
+	{
+		auto result = std::vector<handle> {};
+
+		m_spatial_index.query(volume, [&result](const handle& handle) { result.push_back(handle); });
+
+		return result;
+	}
+
+	auto scene::objects_within(const geometry::frustum& volume) const -> std::vector<handle>
+	{
+		auto result = std::vector<handle> {};
+
+		m_spatial_index.query(volume, [&result](const handle& handle) { result.push_back(handle); });
+
+		return result;
+	}
+
+	auto scene::objects_along(const geometry::ray& ray, const geometry::scalar_t max_distance) const
+		-> std::vector<handle>
+	{
+		auto result = std::vector<handle> {};
+
+		m_spatial_index.query(ray, [&result](const handle& handle) { result.push_back(handle); }, max_distance);
+
+		return result;
+	}
+
+	auto scene::remove_mesh(const lh::mesh& mesh) -> void
+	{
+		auto users = std::vector<handle> {};
+
+		for (const auto& [node, handle] : m_objects_by_node)
+			if (object_at(handle).m_mesh == &mesh) users.push_back(handle);
+
+		destroy_objects(users);
+
+		std::erase_if(m_meshes, [&mesh](const auto& owned_mesh) { return owned_mesh.get() == &mesh; });
+	}
+
+	auto scene::meshes() const -> const std::vector<std::unique_ptr<lh::mesh>>&
+	{
+		return m_meshes;
+	}
+
+	auto scene::remove_light(const physical_light& light) -> void
+	{
+		std::erase_if(m_lights, [&light](const auto& owned_light) { return owned_light.get() == &light; });
+	}
+
+	auto scene::lights() const -> const std::vector<std::unique_ptr<physical_light>>&
+	{
+		return m_lights;
+	}
+
+	auto scene::add_camera(const camera_t::create_info<camera_type::perspective>& create_info) -> camera_t&
+	{
+		auto& camera = *m_cameras.emplace_back(std::make_unique<camera_t>(make_pooled<lh::node>(), create_info));
+
+		if (not m_active_camera) m_active_camera = &camera;
+
+		return camera;
+	}
+
+	auto scene::remove_camera(const camera_t& camera) -> void
+	{
+		std::erase_if(m_cameras, [&camera](const auto& owned_camera) { return owned_camera.get() == &camera; });
+
+		if (m_active_camera == &camera) m_active_camera = m_cameras.empty() ? nullptr : m_cameras.front().get();
+	}
+
+	auto scene::active_camera(camera_t& camera) -> void
+	{
+		m_active_camera = &camera;
+	}
+
+	auto scene::active_camera() const -> camera_t&
+	{
+		return *m_active_camera;
+	}
+
+	auto scene::cameras() const -> const std::vector<std::unique_ptr<camera_t>>&
+	{
+		return m_cameras;
+	}
+
+	auto scene::validated(const create_info& create_info) -> scene::create_info
+	{
+		auto result = create_info;
+
+		if (result.m_spatial_index_root_size <= 0.0f)
+		{
+			output::warning() << "scene spatial index root size needs to be positive, using the default";
+			result.m_spatial_index_root_size = scene::create_info {}.m_spatial_index_root_size;
+		}
+
+		return result;
+	}
+
+	auto scene::object_at(const handle& handle) const -> object&
+	{
+		return *m_objects.get(handle);
+	}
+
+	auto scene::parent_node(const handle& parent) const -> lh::node&
+	{
+		return valid(parent) ? object_at(parent).m_node : lh::node::root_node();
+	}
+
+	auto scene::mark_moved(const lh::node& node) -> void
+	{
+		auto pending_nodes = std::vector<const lh::node*> {&node};
+
+		while (not pending_nodes.empty())
+		{
+			const auto current = pending_nodes.back();
+			pending_nodes.pop_back();
+
+			if (const auto found = m_objects_by_node.find(current); found != m_objects_by_node.end())
+			{
+				auto& object = object_at(found->second);
+
+				if (not object.m_moved) m_moved_objects.push_back(found->second);
+
+				object.m_moved = true;
+			}
+
+			pending_nodes.insert_range(pending_nodes.end(), current->children());
+		}
+	}
+
+	auto scene::release(const handle& handle) -> void
+	{
+		auto& object = object_at(handle);
+
+		m_spatial_index.remove(object.m_spatial_entry);
+		m_objects_by_node.erase(&object.m_node);
+		m_objects.destroy(handle);
+	}
 }
@@ -0,0 +1,426 @@
+module;
+
+module transform_hierarchy;
+
+import output;
+
+namespace lh
+{
+	transform_hierarchy::transform_hierarchy(const std::size_t initial_capacity)
+		: m_local_transformations {},
+		  m_global_transformations {},
+		  m_parents {},
+		  m_subtree_sizes {},
+		  m_invalid {},
+		  m_slots_of_entries {},
+		  m_first_children {},
+		  m_last_children {},
+		  m_previous_siblings {},
+		  m_next_siblings {},
+		  m_first_top_level_entry {s_null_index},
+		  m_last_top_level_entry {s_null_index},
+		  m_ordered {true},
+		  m_slots {},
+		  m_free_slots {},
+		  m_destroyed_count {}
+	{
+		m_local_transformations.reserve(initial_capacity);
+		m_global_transformations.reserve(initial_capacity);
+		m_parents.reserve(initial_capacity);
+		m_subtree_sizes.reserve(initial_capacity);
+		m_invalid.reserve(initial_capacity);
+		m_slots_of_entries.reserve(initial_capacity);
+		m_first_children.reserve(initial_capacity);
+		m_last_children.reserve(initial_capacity);
+		m_previous_siblings.reserve(initial_capacity);
+		m_next_siblings.reserve(initial_capacity);
+		m_slots.reserve(initial_capacity);
+	}
+
+	auto transform_hierarchy::create(const handle& parent, const geometry::transformation_t& transformation) -> handle
+	{
+		const auto parent_index = valid(parent) ? index(parent) : s_null_index;
+		const auto position = static_cast<index_t>(m_parents.size());
+
+		m_local_transformations.push_back(transformation);
+		m_global_transformations.push_back(transformation);
+		m_parents.push_back(parent_index);
+		m_subtree_sizes.push_back(1);
+		m_invalid.push_back(true);
+		m_slots_of_entries.push_back(s_null_index);
+		m_first_children.push_back(s_null_index);
+		m_last_children.push_back(s_null_index);
+		m_previous_siblings.push_back(s_null_index);
+		m_next_siblings.push_back(s_null_index);
+
+		link(position, parent_index);
+
+		// the entry only extends the range of its parent if that range reaches the end of the storage
+		if (m_ordered and parent_index != s_null_index)
+		{
+			if (parent_index + m_subtree_sizes[parent_index] == position)
+				add_to_ancestor_sizes(parent_index, 1);
+			else
+				m_ordered = false;
+		}
+
+		auto slot_index = static_cast<index_t>(m_slots.size());
+
+		if (m_free_slots.empty())
+			m_slots.emplace_back(position, generation_t {});
+		else
+		{
+			slot_index = m_free_slots.back();
+			m_free_slots.pop_back();
+			m_slots[slot_index].m_index = position;
+		}
+
+		m_slots_of_entries[position] = slot_index;
+
+		return {slot_index, m_slots[slot_index].m_generation};
+	}
+
+	auto transform_hierarchy::destroy(const handle& handle) -> void
+	{
+		if (not valid(handle)) return;
+
+		const auto entry = index(handle);
+
+		// descendants are left linked to each other, they are no longer reachable once the entry is unlinked
+		unlink(entry);
+		for_each_in_subtree(entry, [this](const index_t i) { release(i); });
+	}
+
+	auto transform_hierarchy::collapse(const handle& handle) -> void
+	{
+		if (not valid(handle)) return;
+
+		const auto collapsed = index(handle);
+		const auto parent = m_parents[collapsed];
+
+		// children take the place of the collapsed entry among its siblings, and remain within the range of their
+		// new parent
+		const auto first = m_first_children[collapsed];
+		const auto last = m_last_children[collapsed];
+		const auto previous = m_previous_siblings[collapsed];
+		const auto next = m_next_siblings[collapsed];
+
+		if (first == s_null_index)
+			unlink(collapsed);
+		else
+		{
+			for (auto child = first; child != s_null_index; child = m_next_siblings[child])
+			{
+				m_parents[child] = parent;
+				invalidate(child);
+			}
+
+			m_previous_siblings[first] = previous;
+			m_next_siblings[last] = next;
+			(previous == s_null_index ? first_child(parent) : m_next_siblings[previous]) = first;
+			(next == s_null_index ? last_child(parent) : m_previous_siblings[next]) = last;
+		}
+
+		release(collapsed);
+	}
+
+	auto transform_hierarchy::reparent(const handle& handle, const transform_hierarchy::handle& parent) -> void
+	{
+		if (not valid(handle)) return;
+
+		const auto entry = index(handle);
+		const auto parent_index = valid(parent) ? index(parent) : s_null_index;
+
+		for (auto ancestor = parent_index; ancestor != s_null_index; ancestor = m_parents[ancestor])
+			if (ancestor == entry)
+			{
+				output::warning() << "transform hierarchy entry can not become a descendent of itself";
+				return;
+			}
+
+		unlink(entry);
+		link(entry, parent_index);
+
+		m_parents[entry] = parent_index;
+		m_ordered = false;
+
+		invalidate(entry);
+	}
+
+	auto transform_hierarchy::valid(const handle& handle) const -> bool
+	{
+		return handle.m_index < m_slots.size() and m_slots[handle.m_index].m_index != s_null_index and
+			   m_slots[handle.m_index].m_generation == handle.m_generation;
+	}
+
+	auto transform_hierarchy::parent(const handle& handle) const -> transform_hierarchy::handle
+	{
+		if (not valid(handle)) return {};
+
+		const auto parent_index = m_parents[index(handle)];
+
+		if (parent_index == s_null_index) return {};
+
+		const auto parent_slot = m_slots_of_entries[parent_index];
+
+		return {parent_slot, m_slots[parent_slot].m_generation};
+	}
+
+	auto transform_hierarchy::size() const -> const std::size_t
+	{
+		return m_slots_of_entries.size() - m_destroyed_count;
+	}
+
+	auto transform_hierarchy::local_transformation(const handle& handle,
+												   const geometry::transformation_t& transformation) -> void
+	{
+		const auto entry = index(handle);
+
+		m_local_transformations[entry] = transformation;
+		invalidate(entry);
+	}
+
+	auto transform_hierarchy::local_transformation(const handle& handle) const -> const geometry::transformation_t&
+	{
+		return m_local_transformations[index(handle)];
+	}
+
+	auto transform_hierarchy::global_transformation(const handle& handle) -> const geometry::transformation_t&
+	{
+		const auto entry = index(handle);
+
+		recalculate(entry);
+
+		return m_global_transformations[entry];
+	}
+
+	auto transform_hierarchy::update() -> void
+	{
+		if (not m_ordered or m_destroyed_count * 4 > m_slots_of_entries.size()) compact();
+
+		sweep(0, static_cast<index_t>(m_parents.size()));
+	}
+
+	auto transform_hierarchy::update(job_system& job_system) -> void
+	{
+		if (not m_ordered or m_destroyed_count * 4 > m_slots_of_entries.size()) compact();
+
+		const auto entry_count = static_cast<index_t>(m_parents.size());
+		const auto grain = std::max(s_min_entries_per_job,
+									static_cast<index_t>(entry_count / ((job_system.thread_count() + 1) * 4)));
+
+		if (entry_count <= grain)
+		{
+			sweep(0, entry_count);
+			return;
+		}
+
+		// ranges made of whole subtrees, subtrees larger than the grain get their top entry updated up front
+		// and their children distributed instead
+		auto ranges = std::vector<std::pair<index_t, index_t>> {};
+		auto pending_ranges = std::vector<std::pair<index_t, index_t>> {{0, entry_count}};
+
+		while (not pending_ranges.empty())
+		{
+			const auto [first, last] = pending_ranges.back();
+			pending_ranges.pop_back();
+
+			for (auto i = first; i < last;)
+			{
+				// destroyed entries might have lost parts of their subtrees, their sizes are not to be trusted
+				const auto size = m_slots_of_entries[i] == s_null_index ? 1 : m_subtree_sizes[i];
+
+				if (size > grain)
+				{
+					sweep(i, i + 1);
+					pending_ranges.emplace_back(i + 1, i + size);
+				}
+				else if (not ranges.empty() and ranges.back().second == i and
+						 ranges.back().second - ranges.back().first + size <= grain)
+					ranges.back().second += size;
+				else
+					ranges.emplace_back(i, i + size);
+
+				i += size;
+			}
+		}
+
+		job_system.parallel_for(ranges.size(), 1, [this, &ranges](const std::size_t first, const std::size_t last) {
+			for (auto i = first; i < last; i++)
+				sweep(ranges[i].first, ranges[i].second);
+		});
+	}
+
+	auto transform_hierarchy::update(const handle& handle) -> void
+	{
+		if (not valid(handle)) return;
+
+		if (not m_ordered) compact();
+
+		const auto first = index(handle);
+
+		recalculate(first);
+		sweep(first + 1, first + m_subtree_sizes[first]);
+	}
+
+	auto transform_hierarchy::compact() -> void
+	{
+		if (m_ordered and m_destroyed_count == 0) return;
+
+		const auto entry_count = m_slots_of_entries.size();
+
+		// live entries in depth first order, destroyed ones are not linked anymore
+		auto order = std::vector<index_t> {};
+		auto new_indices = std::vector<index_t>(entry_count, s_null_index);
+
+		order.reserve(entry_count - m_destroyed_count);
+
+		for (auto top_level_entry = m_first_top_level_entry; top_level_entry != s_null_index;
+			 top_level_entry = m_next_siblings[top_level_entry])
+			for_each_in_subtree(top_level_entry, [&order, &new_indices](const index_t i) {
+				new_indices[i] = static_cast<index_t>(order.size());
+				order.push_back(i);
+			});
+
+		const auto new_index = [&new_indices](const index_t i) {
+			return i == s_null_index ? s_null_index : new_indices[i];
+		};
+
+		const auto reorder = [&order](auto& entries, const auto& transform) {
+			auto reordered = std::remove_cvref_t<decltype(entries)> {};
+
+			reordered.reserve(order.size());
+
+			for (const auto i : order)
+				reordered.push_back(transform(entries[i]));
+
+			entries = std::move(reordered);
+		};
+
+		const auto same = [](const auto& entry) { return entry; };
+
+		reorder(m_local_transformations, same);
+		reorder(m_global_transformations, same);
+		reorder(m_parents, new_index);
+		reorder(m_invalid, same);
+		reorder(m_slots_of_entries, same);
+		reorder(m_first_children, new_index);
+		reorder(m_last_children, new_index);
+		reorder(m_previous_siblings, new_index);
+		reorder(m_next_siblings, new_index);
+
+		m_first_top_level_entry = new_index(m_first_top_level_entry);
+		m_last_top_level_entry = new_index(m_last_top_level_entry);
+
+		// children follow their parents, so sizes are accumulated back to front
+		m_subtree_sizes.assign(order.size(), 1);
+
+		for (auto i = order.size(); i-- > 0;)
+		{
+			if (m_parents[i] != s_null_index) m_subtree_sizes[m_parents[i]] += m_subtree_sizes[i];
+
+			m_slots[m_slots_of_entries[i]].m_index = static_cast<index_t>(i);
+		}
+
+		m_destroyed_count = 0;
+		m_ordered = true;
+	}
+
+	auto transform_hierarchy::index(const handle& handle) const -> index_t
+	{
+		return m_slots[handle.m_index].m_index;
+	}
+
+	auto transform_hierarchy::recalculate(const index_t entry) -> void
+	{
+		if (not m_invalid[entry]) return;
+
+		const auto parent = m_parents[entry];
+
+		if (parent == s_null_index)
+			m_global_transformations[entry] = m_local_transformations[entry];
+		else
+		{
+			recalculate(parent);
+			m_global_transformations[entry] = m_local_transformations[entry] * m_global_transformations[parent];
+		}
+
+		m_invalid[entry] = false;
+	}
+
+	auto transform_hierarchy::invalidate(const index_t entry) -> void
+	{
+		if (m_ordered)
+			std::fill_n(m_invalid.begin() + entry, m_subtree_sizes[entry], std::uint8_t {true});
+		else
+			for_each_in_subtree(entry, [this](const index_t i) { m_invalid[i] = true; });
+	}
+
+	auto transform_hierarchy::sweep(const index_t first, const index_t last) -> void
+	{
+		// parents precede their children, their global transformations are always up to date by the time they are read
+		for (auto i = first; i < last; i++)
+		{
+			if (not m_invalid[i] or m_slots_of_entries[i] == s_null_index) continue;
+
+			const auto parent = m_parents[i];
+
+			m_global_transformations[i] = parent == s_null_index
+											  ? m_local_transformations[i]
+											  : m_local_transformations[i] * m_global_transformations[parent];
+			m_invalid[i] = false;
+		}
+	}
+
+	auto transform_hierarchy::release(const index_t entry) -> void
+	{
+		auto& slot = m_slots[m_slots_of_entries[entry]];
+
+		slot.m_index = s_null_index;
+		slot.m_generation++;
+
+		m_free_slots.push_back(m_slots_of_entries[entry]);
+		m_slots_of_entries[entry] = s_null_index;
+		m_destroyed_count++;
+	}
+
+	auto transform_hierarchy::link(const index_t entry, const index_t parent) -> void
+	{
+		const auto previous = last_child(parent);
+
+		m_previous_siblings[entry] = previous;
+		m_next_siblings[entry] = s_null_index;
+
+		(previous == s_null_index ? first_child(parent) : m_next_siblings[previous]) = entry;
+		last_child(parent) = entry;
+	}
+
+	auto transform_hierarchy::unlink(const index_t entry) -> void
+	{
+		const auto parent = m_parents[entry];
+		const auto previous = m_previous_siblings[entry];
+		const auto next = m_next_siblings[entry];
+
+		(previous == s_null_index ? first_child(parent) : m_next_siblings[previous]) = next;
+		(next == s_null_index ? last_child(parent) : m_previous_siblings[next]) = previous;
+
+		m_previous_siblings[entry] = s_null_index;
+		m_next_siblings[entry] = s_null_index;
+	}
+
+	auto transform_hierarchy::first_child(const index_t parent) -> index_t&
+	{
+		return parent == s_null_index ? m_first_top_level_entry : m_first_children[parent];
+	}
+
+	auto transform_hierarchy::last_child(const index_t parent) -> index_t&
+	{
+		return parent == s_null_index ? m_last_top_level_entry : m_last_children[parent];
+	}
+
+	auto transform_hierarchy::add_to_ancestor_sizes(const index_t entry, const std::int64_t size) -> void
+	{
+		for (auto ancestor = entry; ancestor != s_null_index; ancestor = m_parents[ancestor])
+			m_subtree_sizes[ancestor] = static_cast<index_t>(m_subtree_sizes[ancestor] + size);
+	}
+}